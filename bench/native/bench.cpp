@@ -0,0 +1,1177 @@
+/**
+ * @brief host benchmark for the decoder and the patterns ([env:native])
+ * pio run -e native && .pio/build/native/program
+ *
+ * the firmware runs against the virtual clock of lib/nativeHal, so every run
+ * feeds the exact same edges and renders the exact same frames.
+ * only the ns figures come from the wall clock, compare them between commits
+ * on the same machine.
+ */
+#ifndef PIO_UNIT_TESTING // pio test -e native builds the tests in test/ with their own main()
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "native_hal.h"
+#include "data.h"
+#include "scheduler.h"
+#include "power.h"
+#include "clock.h"
+#include "hit_log.h"
+#include "hit_cache.h"
+#include "i2c_target.h"
+#include "patterns.h"
+#include "named_patterns.h"
+#include "ir_trace.h"
+#include "stream_patterns.h"
+
+#define BENCH_FRAMES 20000
+#define BENCH_PACKETS 20000
+#define BENCH_FRAME_MS FRAME_MS // patterns.h
+#define BENCH_SHOW_US (10 * 30 + 50) // SHOW_US in main.cpp
+
+void startPattern(uint8_t number);
+void startTransition();
+void render_transition();
+extern bool patternPainted;
+extern CRGBArray<NUM_LEDS> leds;
+extern uint16_t transitionFrom[NUM_LEDS];
+extern uint8_t transitionLevel;
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+/* #region decoder */
+// make a packet that passes readIr()
+static uint32_t valid_packet(uint32_t payload)
+{
+    return Data.encodePacket(IrDataPacket(payload)).get_raw();
+}
+
+// an edge that falls inside a show() is only seen after it, like on the avr
+// every receiver sees the shot, one pin change interrupt each
+static void play(const Edge &edge)
+{
+    if (edge.at > micros())
+        nativeHal::setMicros(edge.at);
+    for (uint8_t pin : ir_receiver_pins)
+        nativeHal::setPin(pin, edge.level);
+}
+
+static uint16_t send_packet(uint32_t raw)
+{
+    static Trace edges;
+    edges.clear();
+    uint32_t end = encodeFrame(edges, micros(), raw);
+    for (const Edge &edge : edges)
+        play(edge);
+    nativeHal::setMicros(end);
+    return edges.size() * IR_RECEIVERS;
+}
+
+static bool bench_decoder()
+{
+    uint32_t packets[16];
+    uint32_t expected[16]; // readIr() hands out the packet with the crc folded out
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        IrDataPacket p(0);
+        p.set_team(1 << (i % 3));
+        p.set_action(eActionDamage);
+        p.set_player_id(0x123 + i * 97);
+        packets[i] = valid_packet(p.get_raw());
+        expected[i] = Data.calculateCRC(packets[i]);
+    }
+
+    nativeHal::reset();
+    Data.readIr();
+    uint32_t edges = 0;
+    uint32_t decoded = 0;
+    double readIr_ns = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t n = 0; n < BENCH_PACKETS; n++)
+    {
+        edges += send_packet(packets[n & 15]);
+        bench_clock::time_point read_start = bench_clock::now();
+        if (Data.readIr().get_raw() == expected[n & 15])
+            decoded++;
+        readIr_ns += elapsed_ns(read_start);
+    }
+    double total_ns = elapsed_ns(start) - readIr_ns;
+
+    printf("decoder: %lu/%lu packets, %lu edges on %d receivers, %u duplicates dropped\n", (unsigned long)decoded,
+           (unsigned long)BENCH_PACKETS, (unsigned long)edges, IR_RECEIVERS, Data.getDuplicateCount());
+    printf("  %-24s %10.1f ns/edge\n", "handlePinChange", total_ns / edges);
+    printf("  %-24s %10.1f ns/call\n", "readIr", readIr_ns / BENCH_PACKETS);
+
+    // shots arriving back to back while loop() is busy: the queue keeps IR_QUEUE_SIZE of them
+    uint8_t overflows = Data.getOverflowCount();
+    for (uint8_t i = 0; i < IR_QUEUE_SIZE + 2; i++)
+        send_packet(packets[i]);
+    IrDataPacket batch[IR_QUEUE_SIZE + 2];
+    uint8_t drained = Data.readIr(batch);
+    printf("  burst of %d: %d drained in one batch, %d overflowed\n", IR_QUEUE_SIZE + 2, drained, Data.getOverflowCount() - overflows);
+
+    // a stray edge, then quiet until the edge timestamps wrap: it must not look like a start mark again
+    uint32_t stray = micros() + 100000;
+    play({stray, false});
+    play({stray + 560, true});
+    nativeHal::setMicros(stray + 30000);
+    Data.canShow(BENCH_SHOW_US);
+    nativeHal::setMicros(stray + 65536UL * IR_TICK_US + ir_start_min_us);
+    bool ok = Data.canShow(BENCH_SHOW_US);
+    printf("  stray edge %lu us old %s\n", (unsigned long)(micros() - stray), ok ? "ok" : "blocks show() as if it had just come");
+
+    // a frame that lost its stop mark: the airtime left runs out, it doesn't wrap around
+    Trace truncated;
+    encodeFrame(truncated, micros() + 100000, packets[0]);
+    truncated.resize(truncated.size() - 2);
+    for (const Edge &edge : truncated)
+        play(edge);
+    uint32_t last = truncated.back().at;
+    uint32_t longest = 0;
+    for (uint32_t since = 0; since < ir_bit_max_us + 1000; since += 16)
+    {
+        nativeHal::setMicros(last + since);
+        longest = std::max(longest, Data.remainingAirtime());
+    }
+    bool bounded = longest <= 3370;
+    printf("  stop mark lost: at most %lu us airtime left %s\n", (unsigned long)longest, bounded ? "ok" : "wrapped around");
+    Data.flushIr();
+    return ok && bounded;
+}
+
+#if IR_ADAPTIVE
+// a blaster (or a hat) whose RC clock runs 'skew' times the nominal period, with noise on the receiver output
+struct Noise
+{
+    const char *name;
+    Fuzz fuzz;
+};
+
+// share of the frames decoded right [permille]
+static uint16_t decode_rate(bool adaptive, float skew, const Noise &noise, uint16_t frames)
+{
+    std::mt19937 rng(1234); // both modes get the same edges
+    Trace trace;
+    std::vector<uint32_t> sent;
+    uint32_t t = 10000;
+    for (uint16_t n = 0; n < frames; n++)
+    {
+        sent.push_back(valid_packet(0x3C5A + n * 7));
+        t = encodeFrame(trace, t, sent.back(), skew) + 20000;
+    }
+    fuzzTrace(trace, noise.fuzz, rng);
+    return (uint32_t)replayTrace(trace, sent, adaptive).matched * 1000 / frames;
+}
+
+// decode rate of the fixed +-20 % windows against IR_ADAPTIVE on the same noisy, skewed edges
+static bool bench_adaptive()
+{
+    const uint16_t frames = 400;
+    const float skews[] = {0.72, 0.78, 0.85, 0.92, 1.0, 1.08, 1.15, 1.22, 1.3, 1.38};
+    const Noise noises[] = {
+        {"clean", {0, 0, 0, 0}},
+        {"jitter 150us", {150, 0, 0, 0}},
+        {"3% spikes", {20, 0, 30, 0}},
+        {"3% dropouts", {20, 0, 0, 30}},
+        {"all of it", {150, 0, 30, 30}},
+    };
+
+    printf("adaptive: %u frames per case, %% decoded with fixed / adaptive windows\n  %-6s", frames, "skew");
+    for (const Noise &noise : noises)
+        printf(" %15s", noise.name);
+    printf("\n");
+    bool ok = true;
+    for (float skew : skews)
+    {
+        printf("  %-6.2f", skew);
+        for (const Noise &noise : noises)
+        {
+            uint16_t fixed = decode_rate(false, skew, noise, frames);
+            uint16_t adaptive = decode_rate(true, skew, noise, frames);
+            printf("   %5.1f / %5.1f", fixed / 10.0, adaptive / 10.0);
+            ok &= adaptive >= fixed;
+        }
+        printf("\n");
+    }
+    if (!ok)
+        printf("  the adaptive windows decoded less than the fixed ones\n");
+    return ok;
+}
+#endif
+
+/* #region corpus */
+#ifndef BENCH_CORPUS
+#define BENCH_CORPUS "bench/corpus" // relative to where the program runs, the repository root
+#endif
+#define CORPUS_FUZZ_SEEDS 8
+
+// name.vcd or name.csv and name.frames next to it, the frames it has to decode to
+static std::vector<std::string> corpus_traces()
+{
+    std::vector<std::string> names;
+    if (DIR *dir = opendir(BENCH_CORPUS))
+    {
+        while (dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && (name.compare(name.size() - 4, 4, ".vcd") == 0 || name.compare(name.size() - 4, 4, ".csv") == 0))
+                names.push_back(name);
+        }
+        closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static void print_replay(const char *name, const ReplayResult &r, size_t expected)
+{
+    printf("  %-28s %5u/%-5zu %5u valid %5u done %9.0f frames/s %6.1f ns/edge\n", name, r.matched, expected, r.valid, r.completed,
+           r.matched * 1e9 / r.ns, r.ns / r.edges);
+}
+
+// every trace as recorded, then with more noise on top; fails when the decoder built finds fewer frames than the fixed windows
+static bool bench_corpus()
+{
+    std::vector<std::string> names = corpus_traces();
+    if (names.empty())
+    {
+        printf("corpus: nothing in %s\n", BENCH_CORPUS);
+        return false;
+    }
+    const Fuzz fuzz = {100, 5, 20, 20};
+    printf("corpus: %s, frames found/expected, fixed windows then %s; fuzzed: +-%u us, %.1f%% drops, %.1f%% spikes, %.1f%% dropouts, %d seeds\n",
+           BENCH_CORPUS, IR_ADAPTIVE ? "adaptive" : "fixed again", fuzz.jitter, fuzz.drops / 10.0, fuzz.spikes / 10.0, fuzz.dropouts / 10.0,
+           CORPUS_FUZZ_SEEDS);
+    bool ok = true;
+    for (const std::string &name : names)
+    {
+        std::string path = std::string(BENCH_CORPUS "/") + name;
+        Trace trace;
+        std::vector<uint32_t> frames;
+        if (!loadTrace(path.c_str(), trace) || !loadFrames((path.substr(0, path.size() - 4) + ".frames").c_str(), frames))
+        {
+            printf("  %s: can't read it or its .frames\n", name.c_str());
+            ok = false;
+            continue;
+        }
+        printf(" %s: %zu edges\n", name.c_str(), trace.size());
+        ReplayResult fixed = replayTrace(trace, frames, false);
+        ReplayResult built = replayTrace(trace, frames, true);
+        print_replay("as recorded, fixed", fixed, frames.size());
+        print_replay("as recorded", built, frames.size());
+        ok &= built.matched >= fixed.matched;
+
+        ReplayResult fixed_fuzzed = {}, fuzzed = {};
+        for (uint32_t seed = 0; seed < CORPUS_FUZZ_SEEDS; seed++)
+        {
+            std::mt19937 rng(seed);
+            Trace noisy = trace;
+            fuzzTrace(noisy, fuzz, rng);
+            for (bool adaptive : {false, true})
+            {
+                ReplayResult r = replayTrace(noisy, frames, adaptive);
+                ReplayResult &sum = adaptive ? fuzzed : fixed_fuzzed;
+                sum.edges += r.edges;
+                sum.completed += r.completed;
+                sum.valid += r.valid;
+                sum.matched += r.matched;
+                sum.ns += r.ns;
+            }
+        }
+        print_replay("fuzzed, fixed", fixed_fuzzed, frames.size() * CORPUS_FUZZ_SEEDS);
+        print_replay("fuzzed", fuzzed, frames.size() * CORPUS_FUZZ_SEEDS);
+        ok &= fuzzed.matched >= fixed_fuzzed.matched;
+    }
+    if (!ok)
+        printf("  the decoder found fewer frames than the fixed windows\n");
+    return ok;
+}
+
+// writes the synthetic traces in bench/corpus: blasters with fast and slow clocks, noise, both file formats.
+// real captures go next to them with their .frames
+static bool record_corpus()
+{
+    struct Recording
+    {
+        const char *name;
+        float skews[3]; // the blasters taking turns
+        Fuzz fuzz;
+    };
+    const Recording recordings[] = {
+        {"nominal.vcd", {1.0, 1.0, 1.0}, {0, 0, 0, 0}},
+        {"fast_rc.csv", {0.84, 0.84, 0.84}, {60, 0, 0, 0}},
+        {"slow_rc_noisy.vcd", {1.2, 1.2, 1.2}, {80, 0, 30, 30}},
+        {"three_blasters.csv", {0.9, 1.0, 1.12}, {40, 10, 10, 10}},
+    };
+    bool ok = true;
+    for (const Recording &recording : recordings)
+    {
+        std::mt19937 rng(42);
+        Trace trace;
+        std::string path = std::string(BENCH_CORPUS "/") + recording.name;
+        FILE *frames = fopen((path.substr(0, path.size() - 4) + ".frames").c_str(), "w");
+        if (!frames)
+            return false;
+        fprintf(frames, "# %s, synthetic (corpus-record), frames as sent\n", recording.name);
+        uint32_t t = 5000;
+        for (uint8_t n = 0; n < 12; n++)
+        {
+            IrDataPacket p(0);
+            p.set_team(1 << (n % 3));
+            p.set_action(n % 4 ? eActionDamage : eActionHeal);
+            p.set_player_id(0x2A0 + (n % 3) * 0x111);
+            uint32_t raw = valid_packet(p.get_raw());
+            fprintf(frames, "%08lx\n", (unsigned long)raw);
+            t = encodeFrame(trace, t, raw, recording.skews[n % 3]) + 30000 + n * 1700;
+        }
+        ok &= fclose(frames) == 0;
+        fuzzTrace(trace, recording.fuzz, rng);
+        ok &= path.compare(path.size() - 4, 4, ".vcd") == 0 ? saveVcd(path.c_str(), trace) : saveCsv(path.c_str(), trace);
+        printf("corpus-record: %s, %zu edges\n", path.c_str(), trace.size());
+    }
+    return ok;
+}
+/* #endregion */
+
+#if IR_TELEMETRY
+// a frame with a glitch: a short extra mark 300 us after the falling edge of bit 'at'
+static void send_glitched(uint32_t raw, uint8_t at)
+{
+    Trace edges;
+    uint32_t end = encodeFrame(edges, micros(), raw);
+    uint32_t glitch = edges[2 + at * 2].at + 300;
+    edges.insert(edges.begin() + 4 + at * 2, {{glitch, 0}, {glitch + 100, 1}});
+    for (const Edge &edge : edges)
+        play(edge);
+    nativeHal::setMicros(end);
+}
+
+// what the dump on PB1 would show for a mix of good and bad frames
+static bool bench_telemetry()
+{
+    nativeHal::reset();
+    Data.readIr();
+    IrTelemetry t;
+    Data.takeTelemetry(t);
+
+    const uint8_t clean = 12, bad_crc = 3, glitched = 2;
+    uint8_t teams[8] = {};
+    for (uint8_t i = 0; i < clean; i++)
+    {
+        IrDataPacket p(0);
+        p.set_team(1 << (i % 3));
+        p.set_action(eActionDamage);
+        p.set_player_id(0x40 + i);
+        teams[p.get_team()]++;
+        send_packet(valid_packet(p.get_raw()));
+        Data.readIr();
+    }
+    for (uint8_t i = 0; i < bad_crc; i++)
+    {
+        send_packet(valid_packet(0x1234 + i) ^ (1UL << IrDataPacket::Crc::offset)); // a crc bit flipped
+        Data.readIr();
+    }
+    for (uint8_t i = 0; i < glitched; i++)
+    {
+        IrDataPacket p(valid_packet(0x2345 + i));
+#if IR_ADAPTIVE
+        teams[p.get_team()]++; // the glitch filter gets these through
+#endif
+        send_glitched(p.get_raw(), 10 + i);
+        Data.readIr();
+    }
+    Data.takeTelemetry(t);
+
+    printf("telemetry: %u frames started, %u completed, %u idle edges, %u crc failures\n", t.framesStarted, t.framesCompleted,
+           t.idleEdges, t.crcFailures);
+    printf("  rejected %u short, %u between the windows, %u long, %u glitches; %u overruns, %u duplicates\n", t.rejected[eRejectShort],
+           t.rejected[eRejectBetween], t.rejected[eRejectLong], t.rejected[eRejectGlitch], t.overruns, t.duplicates);
+    printf("  teams");
+    for (uint8_t count : t.teams)
+        printf(" %u", count);
+    printf(", actions");
+    for (uint8_t count : t.actions)
+        printf(" %u", count);
+    printf("\n");
+
+    bool ok = t.framesStarted == (clean + bad_crc + glitched) * IR_RECEIVERS && t.crcFailures >= bad_crc &&
+              t.rejected[eRejectShort] + t.rejected[eRejectGlitch] >= glitched && !memcmp(t.teams, teams, sizeof(teams)) &&
+              t.actions[eActionDamage] == clean;
+    if (!ok)
+        printf("  counters don't match the frames sent\n");
+
+#if IR_HISTOGRAM
+    // falling edge to falling edge times of clean frames: peaks at 1120 and 2250 us, start pulses in the last bin
+    IrHistogram h;
+    Data.startCapture();
+    uint32_t edges = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (uint16_t n = 0; n < 2000; n++)
+        edges += send_packet(valid_packet(0x5A5A + n));
+    double capture_ns = elapsed_ns(start);
+    Data.stopCapture();
+    Data.readHistogram(h);
+    Data.flushIr();
+    start = bench_clock::now();
+    for (uint16_t n = 0; n < 2000; n++)
+        send_packet(valid_packet(0x5A5A + n));
+    double plain_ns = elapsed_ns(start);
+    Data.flushIr();
+
+    printf("  histogram [%d us bins]:", IR_HISTOGRAM_BIN_US);
+    for (uint8_t bin = 0; bin <= IR_HISTOGRAM_BINS; bin++)
+        if (h.bins[bin])
+            printf(" %d:%u", bin * IR_HISTOGRAM_BIN_US, h.bins[bin]);
+    printf("\n  %-24s %10.1f ns/edge capturing, %.1f not\n", "handlePinChange", capture_ns / edges, plain_ns / edges);
+#endif
+    return ok;
+}
+#endif
+/* #endregion */
+
+/* #region patterns */
+static uint32_t frame_hash;
+static void hash_frame(const uint8_t *rgb, uint16_t num_leds, uint8_t)
+{
+    for (uint16_t i = 0; i < num_leds * 3; i++)
+        frame_hash = (frame_hash ^ rgb[i]) * 16777619;
+}
+
+static void bench_patterns()
+{
+    printf("patterns: %d frames of %d ms virtual time\n", BENCH_FRAMES, BENCH_FRAME_MS);
+    nativeHal::setShowHook(hash_frame);
+    for (const NamedPattern &named : patterns)
+    {
+        const Pattern &pattern = named.pattern;
+        nativeHal::reset();
+        FastLED.clear();
+        initPatternState(pattern);
+        frame_hash = 2166136261;
+
+        // render on the pattern's own deadlines like patternTicker, show every frame
+        uint32_t due = 0;
+        bench_clock::time_point start = bench_clock::now();
+        for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++)
+        {
+            for (; (int32_t)(millis() - due) >= 0; due += pattern.update_ms)
+                pattern.render();
+            FastLED.show();
+            nativeHal::advanceMillis(BENCH_FRAME_MS);
+        }
+        double ns = elapsed_ns(start);
+        // the hash shows whether a change altered the rendered output
+        printf("  %-24s %10.1f ns/frame  frames %08lx\n", named.name, ns / BENCH_FRAMES, (unsigned long)frame_hash);
+    }
+    nativeHal::setShowHook(nullptr);
+}
+
+// streaming output: the stream has to show what the buffered pattern would,
+// and how long can a strip get at 60 fps
+#define BENCH_STREAM_LEDS 300
+
+template <typename Generator>
+static void bench_generator(const char *name, const Generator &generator)
+{
+    nativeHal::reset();
+    frame_hash = 2166136261;
+    bench_clock::time_point start = bench_clock::now();
+    for (uint16_t frame = 0; frame < 1000; frame++)
+        streamShow(generator, BENCH_STREAM_LEDS, frame, 255);
+    double ns = elapsed_ns(start) / 1000 / BENCH_STREAM_LEDS;
+    printf("  %-24s %10.1f ns/pixel  frames %08lx\n", name, ns, (unsigned long)frame_hash);
+}
+
+static void bench_stream()
+{
+    nativeHal::setShowHook(hash_frame);
+
+    // rainbowColors moves its startIndex before it fills, so its frame n is time n of the stream
+    uint32_t mismatches = 0;
+    initPatternState(patterns[0].pattern);
+    for (uint16_t frame = 1; frame <= 1000; frame++)
+    {
+        rainbowColors();
+        frame_hash = 0;
+        FastLED.show();
+        uint32_t buffered_hash = frame_hash;
+        frame_hash = 0;
+        streamShow(PaletteStream(RainbowColors_p), NUM_LEDS, frame, 255);
+        mismatches += frame_hash != buffered_hash;
+    }
+    printf("stream: %u of 1000 frames differ from the buffered rainbowColors, %d leds below\n", mismatches, BENCH_STREAM_LEDS);
+    bench_generator("PaletteStream", PaletteStream(RainbowColors_p));
+    bench_generator("HatStream", HatStream());
+    nativeHal::setShowHook(nullptr);
+
+    // the wire takes 30 us per led through FastLED, 33 us streamed (11 cycle bits)
+    const uint32_t frame_us = 1000000UL / 60;
+    printf("  %-24s %10lu leds (ram: 3 bytes per led of 512, wire: %lu)\n", "buffered max", 512UL / 3, (unsigned long)(frame_us / 30));
+    printf("  %-24s %10lu leds (wire, less the color_at time per pixel: bench/simavr)\n", "streamed max",
+           (unsigned long)(frame_us / STREAM_PIXEL_US));
+}
+
+// pattern state is one union, the running pattern owns it
+static void bench_ram()
+{
+    printf("ram: pattern state %u bytes, shared by all patterns\n", (unsigned)sizeof(PatternState));
+    for (const NamedPattern &named : patterns)
+        printf("  %-24s %10u bytes\n", named.name, named.pattern.state_size);
+    printf("  %-24s %10u of %u enabled in gPatterns\n", "gPatterns", gPatternCount, (unsigned)(sizeof(patterns) / sizeof(patterns[0])));
+}
+// crossfade from rainbowColors into every pattern: the cost render_transition adds to a frame
+static void bench_transition()
+{
+    const uint16_t frames = 64; // the whole transition and some frames after it
+    printf("transition: %u bytes of ram, %u frames each\n", (unsigned)(sizeof(transitionFrom) + sizeof(transitionLevel) + sizeof(patternPainted)), frames);
+    for (const NamedPattern &named : patterns)
+    {
+        nativeHal::reset();
+        initPatternState(patterns[0].pattern);
+        for (uint8_t i = 0; i < 10; i++)
+            patterns[0].pattern.render();
+        startTransition();
+        initPatternState(named.pattern);
+        FastLED.clear();
+
+        uint32_t due = 0;
+        uint16_t blended = 0;
+        double ns = 0;
+        for (uint16_t frame = 0; frame < frames; frame++)
+        {
+            nativeHal::advanceMillis(BENCH_FRAME_MS);
+            patternPainted = false;
+            for (; (int32_t)(millis() - due) >= 0; due += named.pattern.update_ms)
+            {
+                named.pattern.render();
+                patternPainted = true;
+            }
+            blended += patternPainted && transitionLevel != 255;
+            bench_clock::time_point start = bench_clock::now();
+            render_transition();
+            ns += elapsed_ns(start);
+        }
+        printf("  %-24s %10.1f ns/frame  %u frames blended\n", named.name, ns / frames, blended);
+    }
+}
+
+/* #region loop */
+// the whole loop() with a shot every 250 ms, stepped in BENCH_LOOP_STEP_US of virtual time
+// so the ir edges land between and during frames like they would on the hat.
+// show() costs SHOW_US of virtual time with interrupts off, edges inside it arrive late.
+// with idle sleep loop() hands the clock back through the sleep hook, which plays the
+// edges up to the wake of the next timer interrupt.
+// the hit log and a badge polling the i2c target every 100 ms run along when they are built in
+#define BENCH_LOOP_STEP_US 100
+
+extern Ticker frameTicker;
+extern Ticker patternTicker;
+extern bool irAwareShow;
+extern IdleSleep idleSleep;
+extern bool sleepBetweenFrames;
+extern ClockScaler clockScaler;
+extern bool clockScaling;
+
+static Trace shots;
+static size_t next_shot;
+static uint32_t slow_edges; // edges that came in on the slow clock
+
+// on the slow clock the ISR takes its timestamp that many cycles of it after the edge
+#define BENCH_ISR_CYCLES 40
+
+static void play_shot()
+{
+    Edge edge = shots[next_shot++];
+    if (clockScaler.isSlow())
+    {
+        slow_edges++;
+        edge.at += (BENCH_ISR_CYCLES << CLOCK_SLOW_SHIFT) / (F_CPU / 1000000UL);
+    }
+    play(edge);
+}
+
+static void play_until(uint32_t now)
+{
+    while (next_shot < shots.size() && shots[next_shot].at <= now)
+        play_shot();
+}
+
+// an edge before the timer wakes the core ends the sleep, like its pin change interrupt
+static void sleep_until(uint32_t wake_us)
+{
+    if (next_shot < shots.size() && shots[next_shot].at < wake_us)
+        play_shot();
+    else
+        nativeHal::setMicros(wake_us);
+}
+
+#if I2C_TARGET
+// the badge on the i2c bus: all packets waiting, in one read, the count, then as many packets
+static uint8_t host_packets(std::vector<uint32_t> &packets)
+{
+    nativeHal::i2cStart(I2C_ADDRESS, false);
+    nativeHal::i2cWrite(eI2cPackets);
+    nativeHal::i2cStart(I2C_ADDRESS, true);
+    uint8_t count = nativeHal::i2cRead(true);
+    if (count == 0)
+        nativeHal::i2cRead(false); // acked the count, one more byte ends it
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t raw = 0;
+        for (uint8_t b = 0; b < 4; b++)
+            raw |= (uint32_t)nativeHal::i2cRead(i + 1 < count || b < 3) << (8 * b);
+        packets.push_back(raw);
+    }
+    nativeHal::i2cStop();
+    return count;
+}
+
+static bool host_status(I2cStatus &status)
+{
+    bool acked = nativeHal::i2cStart(I2C_ADDRESS, false) && nativeHal::i2cWrite(eI2cStatus) && nativeHal::i2cStart(I2C_ADDRESS, true);
+    for (uint8_t i = 0; i < sizeof(status); i++)
+        ((uint8_t *)&status)[i] = nativeHal::i2cRead(i + 1u < sizeof(status));
+    nativeHal::i2cStop();
+    return acked;
+}
+
+static std::vector<uint32_t> host_received;
+static uint32_t host_polled_at, host_polls;
+
+// the badge reads every 100 ms
+static void host_poll(uint32_t now)
+{
+    if (now - host_polled_at < 100000)
+        return;
+    host_polled_at = now;
+    host_polls++;
+    host_packets(host_received);
+}
+#endif
+
+// returns the packets decoded
+static uint32_t loop_missed; // frames the ticker missed over every bench_loop() run
+static uint32_t loop_lost;   // packets the i2c host or the hit log lost over every run
+
+static uint16_t bench_loop(bool ir_aware, bool sleep, bool scale)
+{
+    uint32_t packets[3];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        IrDataPacket p(0);
+        p.set_team(1 << i);
+        p.set_action(eActionDamage);
+        p.set_player_id(0x456 + i);
+        packets[i] = valid_packet(p.get_raw());
+    }
+
+    const uint32_t duration = BENCH_FRAMES * (1000000UL / 60);
+    shots.clear();
+    next_shot = 0;
+    slow_edges = 0;
+    uint16_t sent = 0;
+    for (uint32_t t = 100000; t < duration; sent++)
+        t = encodeFrame(shots, t, packets[sent % 3]) + 250000;
+
+    clockScaler.fast();
+    nativeHal::reset();
+    nativeHal::setShowMicros(BENCH_SHOW_US);
+    nativeHal::setSleepHook(sleep_until);
+    irAwareShow = ir_aware;
+    sleepBetweenFrames = sleep;
+    clockScaling = scale;
+    frameTicker.restart();
+    startPattern(0);
+#if HIT_LOG
+    hitLog.begin();
+#endif
+#if I2C_TARGET
+    i2cTarget.begin();
+    host_received.clear();
+    host_polled_at = host_polls = 0;
+    uint32_t interrupts = nativeHal::i2cInterrupts();
+#endif
+    frameTicker.resetStats();
+    idleSleep.resetStats();
+    uint8_t overflows = Data.getOverflowCount();
+    uint16_t received = Data.getReceivedCount();
+
+    // the counters are 16 bit, collect them every second like a status report would
+    uint32_t slept = 0, sleeps = 0, wakes[eWakeSources] = {}, slow_us = 0, switches = 0;
+    auto collect = [&]() {
+        slept += idleSleep.getSleptMicros();
+        sleeps += idleSleep.getSleepCount();
+        for (uint8_t source = 0; source < eWakeSources; source++)
+            wakes[source] += idleSleep.getWakeCount((WakeSource)source);
+        idleSleep.resetStats();
+        slow_us += clockScaler.getSlowMicros();
+        switches += clockScaler.getSwitchCount();
+        clockScaler.resetStats();
+    };
+
+    double ns = 0;
+    uint32_t loops = 0;
+    for (uint32_t now = 0; now < duration; now += BENCH_LOOP_STEP_US)
+    {
+        if (now % 1000000 == 0)
+            collect();
+        play_until(now);
+        if (now > micros())
+            nativeHal::setMicros(now);
+        if (micros() > now)
+            continue; // still asleep in the loop() before
+#if I2C_TARGET
+        host_poll(now);
+#endif
+        bench_clock::time_point start = bench_clock::now();
+        loop();
+        ns += elapsed_ns(start);
+        loops++;
+    }
+    collect();
+    clockScaler.fast();
+    nativeHal::setShowMicros(0);
+    nativeHal::setSleepHook(nullptr);
+    irAwareShow = true;
+    sleepBetweenFrames = IDLE_SLEEP;
+    clockScaling = CLOCK_SCALING;
+
+    uint32_t frames = nativeHal::showCount();
+    uint16_t decoded = Data.getReceivedCount() - received;
+    printf("loop, ir aware show %s, %s%s: %lu frames in %lu ms virtual, shot every 250 ms\n", ir_aware ? "on" : "off",
+           sleep ? "idle sleep" : "polling", scale ? " on the slow clock" : "", (unsigned long)frames,
+           (unsigned long)(duration / 1000));
+    printf("  %-24s %10.1f ns/frame (polling included), %lu calls\n", "loop", ns / frames, (unsigned long)loops);
+    printf("  %-24s %10u missed  max late %u us\n", "frameTicker", frameTicker.getMissed(), frameTicker.getMaxLate());
+    printf("  %-24s %u/%u decoded (%.1f%%)  overflows %u\n", "ir", decoded, sent, 100.0 * decoded / sent,
+           (uint8_t)(Data.getOverflowCount() - overflows));
+    if (sleep)
+    {
+        // the host runs loop() in no virtual time, the awake share on the avr comes from bench/simavr
+        printf("  %-24s %10.1f%% of the time in %lu sleeps, wakes/s: %.1f ir  %.1f timer\n", "idle sleep",
+               100.0 * slept / duration, (unsigned long)sleeps, wakes[eWakeIr] * 1e6 / duration,
+               wakes[eWakeTimer] * 1e6 / duration);
+    }
+    if (scale)
+    {
+        printf("  %-24s %10.1f%% of the time at %lu kHz, %.1f switches/s, %lu ir edges came in on it\n", "clock",
+               100.0 * slow_us / duration, (unsigned long)(F_CPU / 1000 >> CLOCK_SLOW_SHIFT), switches * 1e6 / duration,
+               (unsigned long)slow_edges);
+    }
+#if HIT_LOG
+    printf("  %-24s %u waiting, %u dropped\n", "hit log", hitLog.pending(), hitLog.getDropCount());
+    loop_lost += hitLog.getDropCount();
+#endif
+#if I2C_TARGET
+    host_packets(host_received);
+    bool in_order = true;
+    for (size_t i = 0; i < host_received.size(); i++)
+        in_order &= IrDataPacket(host_received[i]).get_player_id() == 0x456 + i % 3;
+    I2cStatus status;
+    host_status(status);
+    printf("  %-24s %zu of %u packets, %u dropped, %.1f USI interrupts per poll\n", "i2c polled every 100 ms",
+           host_received.size(), decoded, status.dropped, (double)(nativeHal::i2cInterrupts() - interrupts) / host_polls);
+    if (!in_order || status.received != Data.getReceivedCount())
+        loop_lost++;
+    loop_lost += decoded - host_received.size();
+#endif
+    loop_missed += frameTicker.getMissed();
+    return decoded;
+}
+/* #endregion */
+
+
+/* #region hitlog */
+#if HIT_LOG
+// the ring over reboots and power cuts is checked by test/test_hit_log, this times it
+static IrDataPacket hit(uint16_t n)
+{
+    IrDataPacket p(0);
+    p.set_team(1 << (n % 3));
+    p.set_action(eActionDamage);
+    p.set_action_param(n % 16);
+    p.set_player_id(n & 0xFFF);
+    return p;
+}
+
+// log hits 'from' up to 'to' a few at a time, the eeprom done in between like loop() would let it
+static void log_hits(uint16_t from, uint16_t to)
+{
+    for (uint16_t n = from; n < to; n++)
+    {
+        hitLog.log(hit(n));
+        if (hitLog.pending() == HIT_LOG_QUEUE)
+            nativeHal::advanceMillis(20);
+    }
+    while (hitLog.pending())
+        nativeHal::advanceMillis(20);
+    nativeHal::advanceMillis(20);
+}
+
+// power cycle: whatever write runs is lost, begin() scans the ring again
+static void reboot()
+{
+    nativeHal::reset();
+    hitLog.begin();
+}
+
+static void bench_hitlog()
+{
+    printf("hit log: %u slots of %u bytes, queue of %u, %u bytes of ram\n", HIT_LOG_SLOTS, HIT_LOG_RECORD, HIT_LOG_QUEUE,
+           (unsigned)sizeof(HitLog));
+    reboot();
+    const uint16_t hits = 20 * HIT_LOG_SLOTS;
+    uint32_t start_us = micros();
+    uint32_t writes = nativeHal::eepromWrites();
+    log_hits(2000, 2000 + hits);
+    uint32_t busy_us = micros() - start_us;
+    printf("  %-24s %4u hits: %.2f bytes programmed per hit\n", "wear", hits,
+           (double)(nativeHal::eepromWrites() - writes) / hits);
+    printf("  %-24s %10.1f ms per hit of eeprom time, %.0f hits/s sustained\n", "record", busy_us / 1000.0 / hits,
+           hits * 1e6 / busy_us);
+
+    // log() only queues: its cost in loop(), the eeprom done without it
+    const uint32_t calls = 1000000;
+    double ns = 0;
+    for (uint32_t n = 0; n < calls; n += HIT_LOG_QUEUE)
+    {
+        reboot();
+        bench_clock::time_point start = bench_clock::now();
+        for (uint8_t i = 0; i < HIT_LOG_QUEUE; i++)
+            hitLog.log(hit(n + i));
+        ns += elapsed_ns(start);
+    }
+    printf("  %-24s %10.1f ns/call\n", "log", ns / calls);
+    reboot();
+}
+#endif
+/* #endregion */
+
+/* #region hitcache */
+#if HIT_CACHE
+// trigger pulls of 'players' blasters spread over the teams: each sends its frame 1..4 times,
+// the air carries one frame at a time. a sent frame remembers its pull
+struct Pull
+{
+    uint16_t player;
+    uint8_t team;
+};
+struct Sent
+{
+    uint32_t end; // [us], where the decoder completes it
+    uint32_t raw;
+    uint32_t pull;
+};
+
+static IrDataPacket player_packet(uint16_t player, uint8_t team)
+{
+    IrDataPacket p(0);
+    p.set_team(team);
+    p.set_action(eActionDamage);
+    p.set_player_id(0x100 + player * 37); // ids as a game might hand them out, not in a row
+    return p;
+}
+
+static void burst_trace(uint16_t players, uint32_t seconds, std::mt19937 &rng, Trace &trace, std::vector<Pull> &pulls,
+                        std::vector<Sent> &sent)
+{
+    std::uniform_int_distribution<uint32_t> pause(400000, 2500000), gap(10000, 30000);
+    std::uniform_int_distribution<uint16_t> repeats(1, 4);
+    struct Blaster
+    {
+        uint32_t next; // [us] its next frame is ready
+        uint8_t left;  // frames left of the pull
+        uint32_t pull;
+    };
+    std::vector<Blaster> blasters(players);
+    for (Blaster &blaster : blasters)
+        blaster = {pause(rng), 0, 0};
+    trace.clear();
+    pulls.clear();
+    sent.clear();
+    uint32_t air_free = 0;
+    for (;;)
+    {
+        uint16_t player = std::min_element(blasters.begin(), blasters.end(),
+                                           [](const Blaster &a, const Blaster &b) { return a.next < b.next; }) -
+                          blasters.begin();
+        Blaster &blaster = blasters[player];
+        uint32_t t = std::max(blaster.next, air_free);
+        if (t > seconds * 1000000UL)
+            break;
+        const uint8_t teams[] = {eTeamRex, eTeamGiggle, eTeamBuzz};
+        Pull pull = {player, teams[player % 3]};
+        if (!blaster.left)
+        {
+            blaster.left = repeats(rng);
+            blaster.pull = pulls.size();
+            pulls.push_back(pull);
+        }
+        // the repeats of a busy air go out between the frames of other blasters
+        uint32_t raw = valid_packet(player_packet(pull.player, pull.team).get_raw());
+        t = encodeFrame(trace, t, raw);
+        sent.push_back({t - 560, raw, blaster.pull}); // the stop mark ends the last bit
+        air_free = t + 2000;
+        blaster.next = t + (--blaster.left ? gap(rng) : pause(rng));
+    }
+}
+
+struct CacheScore
+{
+    uint32_t counted; // pulls with a hit counted
+    uint32_t doubled; // hits counted again for a pull already counted
+    uint32_t lost;    // pulls that came through but counted none
+};
+
+// the pull of each decoded frame: the sent frame it is, by frame and time
+static void score(const std::vector<Decoded> &decoded, const std::vector<Sent> &sent, size_t pull_count,
+                  const std::vector<bool> &accepted, CacheScore &s)
+{
+    std::vector<uint8_t> counts(pull_count), seen(pull_count);
+    size_t from = 0;
+    for (size_t i = 0; i < decoded.size(); i++)
+    {
+        while (from < sent.size() && sent[from].end + 2000 < decoded[i].at)
+            from++;
+        for (size_t j = from; j < sent.size() && sent[j].end <= decoded[i].at + 2000; j++)
+        {
+            if (sent[j].raw != decoded[i].raw)
+                continue;
+            seen[sent[j].pull] = 1;
+            counts[sent[j].pull] += accepted[i];
+            break;
+        }
+    }
+    for (size_t pull = 0; pull < pull_count; pull++)
+    {
+        s.counted += counts[pull] > 0;
+        s.doubled += counts[pull] > 1 ? counts[pull] - 1 : 0;
+        s.lost += seen[pull] && !counts[pull];
+    }
+}
+
+// the same window rule with no limit on the players
+static bool reference_accept(std::map<uint16_t, uint16_t> &last, IrDataPacket packet, uint16_t now)
+{
+    uint16_t key = packet.get_team() << 12 | packet.get_player_id();
+    auto found = last.find(key);
+    bool repeat = found != last.end() && (uint16_t)(now - found->second) < HIT_CACHE_WINDOW_MS;
+    if (!repeat)
+        last[key] = now;
+    return !repeat;
+}
+
+static bool bench_hitcache()
+{
+    bool ok = true;
+    printf("hit cache: %u sets of %u ways, %u ms window, %u bytes of ram\n", HIT_CACHE_SETS, HIT_CACHE_WAYS,
+           HIT_CACHE_WINDOW_MS, (unsigned)sizeof(HitCache));
+
+    // the rules: repeats inside the window, one after it (the repeats don't move it), and the 16 bit ms wrap
+    HitCache cache;
+    IrDataPacket a = player_packet(1, eTeamRex), b = player_packet(1, eTeamBuzz);
+    const uint16_t end = 1000 + HIT_CACHE_WINDOW_MS;
+    bool rules = cache.accept(a, 1000) && !cache.accept(a, end - 150) && !cache.accept(a, end - 1) && cache.accept(b, end - 1) &&
+                 cache.accept(a, end);
+    cache.expire(end + 10000);
+    rules &= cache.accept(a, end); // 65.5 s on: freed by expire(), not a repeat
+    rules &= cache.getTally(eTeamRex) == 3 && cache.getTally(eTeamBuzz) == 1 && cache.getRepeatCount() == 2;
+    printf("  %-24s %s\n", "window rules", rules ? "ok" : "FAILED");
+    ok &= rules;
+
+    // sustained fire, a frame every third of the window for 30 frames: one hit per window, not one for all of it
+    cache.reset();
+    uint8_t sustained = 0;
+    for (uint8_t n = 0; n < 30; n++)
+        sustained += cache.accept(a, 20000 + n * ((HIT_CACHE_WINDOW_MS + 2) / 3));
+    printf("  %-24s %u of 30 frames counted %s\n", "sustained fire", sustained, sustained == 10 ? "ok" : "FAILED");
+    ok &= sustained == 10;
+
+    printf("  %-12s %6s %6s %6s %8s %8s %8s %8s %8s %8s\n", "players", "pulls", "seen", "frames", "counted", "doubled",
+           "lost", "no cache", "map", "ns/call");
+    const uint16_t player_counts[] = {2, 4, 8, 16, 32};
+    for (uint16_t players : player_counts)
+    {
+        std::mt19937 rng(players);
+        Trace trace;
+        std::vector<Pull> pulls;
+        std::vector<Sent> sent;
+        burst_trace(players, 600, rng, trace, pulls, sent);
+        Fuzz fuzz = {40, 5, 5, 5};
+        fuzzTrace(trace, fuzz, rng);
+        std::vector<Decoded> decoded;
+        replayTrace(trace, {}, true, &decoded);
+
+        CacheScore cached = {}, none = {}, unlimited = {};
+        std::vector<bool> accepted(decoded.size()), all(decoded.size(), true), reference(decoded.size());
+        std::map<uint16_t, uint16_t> last;
+        for (size_t i = 0; i < decoded.size(); i++)
+            reference[i] = reference_accept(last, IrDataPacket(decoded[i].raw), decoded[i].at / 1000);
+        // the last of a few rounds is kept, they time the lookups
+        const uint8_t rounds = 100;
+        double ns = 0;
+        for (uint8_t round = 0; round < rounds; round++)
+        {
+            cache.reset();
+            bench_clock::time_point start = bench_clock::now();
+            for (size_t i = 0; i < decoded.size(); i++)
+            {
+                uint16_t now = decoded[i].at / 1000;
+                if (i && decoded[i].at / (HIT_CACHE_SWEEP_SECONDS * 1000000UL) != decoded[i - 1].at / (HIT_CACHE_SWEEP_SECONDS * 1000000UL))
+                    cache.expire(now);
+                accepted[i] = cache.accept(IrDataPacket(decoded[i].raw), now);
+            }
+            ns += elapsed_ns(start);
+        }
+        score(decoded, sent, pulls.size(), accepted, cached);
+        score(decoded, sent, pulls.size(), all, none);
+        score(decoded, sent, pulls.size(), reference, unlimited);
+
+        uint32_t tallied = 0, seen = cached.counted + cached.lost;
+        for (uint8_t team = 0; team < 8; team++)
+            tallied += cache.getTally(team);
+        uint32_t hits = std::count(accepted.begin(), accepted.end(), true);
+        printf("  %-12u %6zu %6u %6zu %8u %8u %8u %8u %8u %8.1f\n", players, pulls.size(), seen, decoded.size(), cached.counted,
+               cached.doubled, cached.lost, none.counted + none.doubled, unlimited.counted + unlimited.doubled,
+               ns / rounds / decoded.size());
+        ok &= tallied == hits && cached.lost <= unlimited.lost; // a pushed out player counts again, never less
+        if (players <= HIT_CACHE_WAYS)
+            ok &= cached.doubled == unlimited.doubled; // they fit in any one set, nothing pushed out
+        // what the window rule doubles itself in a full air aside, players pushed out add no more than 3 %
+        bool fits = cached.doubled <= unlimited.doubled + unlimited.doubled / 32 + 16;
+        if (!fits)
+            printf("  %u players: %u doubled against %u with no limit, the cache is too small\n", players, cached.doubled,
+                   unlimited.doubled);
+        ok &= fits;
+    }
+
+    return ok;
+}
+#endif
+/* #endregion */
+
+/* #region crc */
+// _data::calculateCRC as it was before the table version, test/test_crc checks the table against it
+static uint32_t reference_crc(uint32_t raw_packet)
+{
+    uint32_t raw = raw_packet;
+    uint32_t checksum = ((raw << 2) & 0b10000000111111110111111100) ^
+                        ((raw << 1) & 0b01111111100000000111111110) ^
+                        ((raw << 0) & 0b00000000111111111111111111) ^
+                        ((raw >> 1) & 0b00000000100000000000000000) ^
+                        ((raw >> 2) & 0b00000000011111110000000000) ^
+                        ((raw >> 3) & 0b00000000111111111000000000) ^
+                        ((raw >> 4) & 0b00000011100000001111111100) ^
+                        ((raw >> 5) & 0b00000000111111111000000010);
+    checksum = checksum ^ (checksum >> 8) ^ (checksum >> 16) ^ (checksum >> 24);
+    checksum = checksum & 0xFF;
+    raw ^= checksum << 24;
+    return raw;
+}
+
+static void bench_crc()
+{
+    volatile uint32_t sink = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (uint32_t raw = 0; raw < 10000000; raw++)
+        sink = sink + reference_crc(raw * 2654435761u);
+    double reference_ns = elapsed_ns(start) / 10000000;
+    start = bench_clock::now();
+    for (uint32_t raw = 0; raw < 10000000; raw++)
+        sink = sink + Data.calculateCRC(raw * 2654435761u);
+    double table_ns = elapsed_ns(start) / 10000000;
+
+    printf("crc\n");
+    printf("  %-24s %10.1f ns/call\n", "shift-xor reference", reference_ns);
+    printf("  %-24s %10.1f ns/call\n", IR_CRC_BYTE_TABLE ? "byte table" : "nibble table", table_ns);
+}
+/* #endregion */
+
+// no arguments runs everything but corpus-record,
+// otherwise any of: decoder telemetry adaptive corpus corpus-record patterns ram transition stream loop hitlog hitcache crc
+// exits non-zero when a check fails: a stale ir edge blocking show(), telemetry counters off, adaptive windows decoding less than fixed ones (also on the corpus),
+// idle sleep or the slow clock decoding less than polling, the loop missing frames or the hit log and the i2c host losing packets in it,
+// the hit cache tallies off or losing pulls. test/ has the unit tests: pio test -e native
+int main(int argc, char *argv[])
+{
+    auto wanted = [&](const char *section) {
+        if (argc < 2)
+            return strcmp(section, "corpus-record") != 0;
+        for (int i = 1; i < argc; i++)
+            if (!strcmp(argv[i], section))
+                return true;
+        return false;
+    };
+
+    nativeHal::reset();
+    setup();
+    bool ok = true;
+    if (wanted("crc"))
+        bench_crc();
+    if (wanted("decoder"))
+        ok &= bench_decoder();
+#if IR_TELEMETRY
+    if (wanted("telemetry"))
+        ok &= bench_telemetry();
+#endif
+#if IR_ADAPTIVE
+    if (wanted("adaptive"))
+        ok &= bench_adaptive();
+#endif
+    if (wanted("corpus-record"))
+        ok &= record_corpus();
+    if (wanted("corpus"))
+        ok &= bench_corpus();
+    if (wanted("patterns"))
+        bench_patterns();
+    if (wanted("ram"))
+        bench_ram();
+    if (wanted("transition"))
+        bench_transition();
+    if (wanted("stream"))
+        bench_stream();
+    if (wanted("loop"))
+    {
+        bench_loop(false, false, false);
+        uint16_t polled = bench_loop(true, false, false);
+        uint16_t slept = bench_loop(true, true, false);
+        uint16_t scaled = bench_loop(true, true, true);
+        if (slept < polled || scaled < polled)
+        {
+            printf("  idle sleep decoded %u, on the slow clock %u packets less than polling\n", polled - slept, polled - scaled);
+            ok = false;
+        }
+        if (loop_missed)
+        {
+            printf("  %lu frames missed, show() waited too long for the ir\n", (unsigned long)loop_missed);
+            ok = false;
+        }
+        if (loop_lost)
+        {
+            printf("  %lu packets lost by the hit log or the i2c host\n", (unsigned long)loop_lost);
+            ok = false;
+        }
+    }
+#if HIT_LOG
+    if (wanted("hitlog"))
+        bench_hitlog();
+#endif
+#if HIT_CACHE
+    if (wanted("hitcache"))
+        ok &= bench_hitcache();
+#endif
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,279 @@
+#include "ir_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "data.h"
+
+/* #region encoder */
+uint32_t encodeFrame(Trace &out, uint32_t t, uint32_t raw, float skew)
+{
+    auto mark = [&](uint32_t length, uint32_t period) {
+        out.push_back({t, 0});
+        out.push_back({t + (uint32_t)(length * skew), 1});
+        t += (uint32_t)(period * skew);
+    };
+    mark(9000, 13500); // start: 16 units of 562.5 us on, 8 off
+    for (uint8_t i = 0; i < ir_bit_lenght; i++)
+        mark(560, (raw >> i) & 1 ? 2250 : 1120);
+    mark(560, 1120); // stop
+    return t;
+}
+/* #endregion */
+
+/* #region fuzzer */
+void fuzzTrace(Trace &trace, const Fuzz &fuzz, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<uint16_t> permille(0, 999);
+    std::uniform_int_distribution<uint32_t> width(20, 120);
+    std::uniform_int_distribution<uint32_t> offset(100, 400);
+    Trace out;
+    out.reserve(trace.size() + trace.size() / 8);
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        const Edge &edge = trace[i];
+        bool mark = !edge.level && i + 1 < trace.size() && trace[i + 1].level;
+        if (!mark)
+        {
+            out.push_back(edge);
+            continue;
+        }
+        const Edge &end = trace[++i];
+        if (permille(rng) < fuzz.drops)
+            continue;
+        out.push_back(edge);
+        out.push_back(end);
+        if (permille(rng) < fuzz.dropouts)
+        {
+            uint32_t x = edge.at + offset(rng);
+            out.push_back({x, 1});
+            out.push_back({x + width(rng), 0});
+        }
+        if (permille(rng) < fuzz.spikes)
+        {
+            uint32_t x = end.at + offset(rng);
+            out.push_back({x, 0});
+            out.push_back({x + width(rng), 1});
+        }
+    }
+    if (fuzz.jitter)
+    {
+        std::uniform_int_distribution<int> jitter(-fuzz.jitter, fuzz.jitter);
+        for (Edge &edge : out)
+            edge.at += jitter(rng);
+    }
+    // a spike inside a mark ends it early, a dropout near its end lengthens it: both happen on real receivers
+    std::stable_sort(out.begin(), out.end(), [](const Edge &a, const Edge &b) { return a.at < b.at; });
+    trace.swap(out);
+}
+/* #endregion */
+
+/* #region import/export */
+static bool endsWith(const char *path, const char *extension)
+{
+    size_t length = strlen(path), size = strlen(extension);
+    return length >= size && !strcasecmp(path + length - size, extension);
+}
+
+// every signal of the file, times from the start of the capture
+struct Signals
+{
+    std::vector<Trace> traces;
+    double origin = -1; // [us]
+
+    // levels that don't change are left out
+    void add(size_t signal, double us, bool level)
+    {
+        if (origin < 0)
+            origin = us;
+        if (signal >= traces.size())
+            traces.resize(signal + 1);
+        Trace &trace = traces[signal];
+        if (trace.empty() || trace.back().level != level)
+            trace.push_back({(uint32_t)llround(us - origin), level});
+    }
+};
+
+// Time [s],Channel 0,Channel 1,... a row per change (Saleae) or per sample (PulseView), headers and ';' comments skipped
+static void loadCsv(std::istream &in, Signals &signals)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || !(isdigit((unsigned char)line[0]) || line[0] == '.' || line[0] == '-'))
+            continue;
+        std::stringstream row(line);
+        std::string cell;
+        std::getline(row, cell, ',');
+        double us = atof(cell.c_str()) * 1e6;
+        for (size_t signal = 0; std::getline(row, cell, ','); signal++)
+            signals.add(signal, us, atoi(cell.c_str()) != 0);
+    }
+}
+
+// one bit signals in the order of their $var, $timescale for the unit
+static void loadVcd(std::istream &in, Signals &signals)
+{
+    std::string token;
+    std::vector<std::string> ids;
+    double unit_us = 1;
+    double now = 0;
+    auto change = [&](const std::string &id, bool level) {
+        for (size_t signal = 0; signal < ids.size(); signal++)
+            if (ids[signal] == id)
+                signals.add(signal, now, level);
+    };
+    while (in >> token)
+    {
+        if (token == "$timescale")
+        {
+            std::string scale, part;
+            while (in >> part && part != "$end")
+                scale += part; // "1ns" or "1 ns"
+            size_t digits = scale.find_first_not_of("0123456789.");
+            std::string unit = digits == std::string::npos ? "" : scale.substr(digits);
+            const char *units[] = {"fs", "ps", "ns", "us", "ms", "s"};
+            const double to_us[] = {1e-9, 1e-6, 1e-3, 1, 1e3, 1e6};
+            for (uint8_t i = 0; i < 6; i++)
+                if (unit == units[i])
+                    unit_us = atof(scale.c_str()) * to_us[i];
+        }
+        else if (token == "$var")
+        {
+            std::string type, size, id;
+            in >> type >> size >> id;
+            if (size == "1")
+                ids.push_back(id);
+        }
+        else if (token[0] == '#')
+            now = atof(token.c_str() + 1) * unit_us;
+        else if (token[0] == '0' || token[0] == '1')
+            change(token.substr(1), token[0] == '1');
+        else if (token[0] == 'b' || token[0] == 'B')
+        {
+            std::string id;
+            in >> id;
+            change(id, token.find('1') != std::string::npos);
+        }
+    }
+}
+
+bool loadTrace(const char *path, Trace &trace, int channel)
+{
+    std::ifstream in(path);
+    Signals signals;
+    if (endsWith(path, ".vcd"))
+        loadVcd(in, signals);
+    else
+        loadCsv(in, signals);
+
+    trace.clear();
+    for (size_t signal = 0; signal < signals.traces.size(); signal++)
+    {
+        if ((channel < 0 && signals.traces[signal].size() > 1) || (int)signal == channel)
+        {
+            trace.swap(signals.traces[signal]);
+            break;
+        }
+    }
+    if (trace.size() < 2)
+        fprintf(stderr, "%s: no edges on channel %d\n", path, channel);
+    return trace.size() >= 2;
+}
+
+bool loadFrames(const char *path, std::vector<uint32_t> &frames)
+{
+    std::ifstream in(path);
+    std::string line;
+    frames.clear();
+    while (std::getline(in, line))
+        if (!line.empty() && line[0] != '#')
+            frames.push_back(strtoul(line.c_str(), nullptr, 16));
+    return bool(in.eof());
+}
+
+bool saveVcd(const char *path, const Trace &trace)
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return false;
+    fprintf(out, "$comment ir receiver output, low is a mark, written by encodeFrame (synthetic) $end\n$timescale 1us $end\n"
+                 "$scope module hat $end\n$var wire 1 ! ir $end\n$upscope $end\n$enddefinitions $end\n");
+    for (const Edge &edge : trace)
+        fprintf(out, "#%u\n%d!\n", edge.at, edge.level);
+    return fclose(out) == 0;
+}
+
+bool saveCsv(const char *path, const Trace &trace)
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return false;
+    fprintf(out, "; ir receiver output, low is a mark, written by encodeFrame (synthetic)\nTime [s],Channel 0\n");
+    for (const Edge &edge : trace)
+        fprintf(out, "%.6f,%d\n", edge.at / 1e6, edge.level);
+    return fclose(out) == 0;
+}
+/* #endregion */
+
+/* #region replay */
+ReplayResult replayTrace(const Trace &trace, const std::vector<uint32_t> &expected, bool adaptive,
+                         std::vector<Decoded> *decoded)
+{
+    ReplayResult result = {};
+    DataReader reader{};
+#if IR_ADAPTIVE
+    bool was_adaptive = DataReader::adaptive;
+    DataReader::adaptive = adaptive;
+#else
+    (void)adaptive; // fixed windows only
+#endif
+    reader.reset();
+
+    std::vector<Decoded> frames;
+    bool level = true; // idle, no mark
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    for (const Edge &edge : trace)
+    {
+        if (edge.level == level)
+            continue; // the pin change interrupt only sees changes
+        level = edge.level;
+        result.edges++;
+        if (reader.handlePinChange(level, (ir_time_t)(edge.at / IR_TICK_US)))
+            frames.push_back({edge.at, reader.lastFrame()});
+    }
+    result.ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+#if IR_ADAPTIVE
+    DataReader::adaptive = was_adaptive;
+#endif
+
+    // expected frames can be lost, not reordered
+    size_t next = 0;
+    if (decoded)
+        decoded->clear();
+    for (const Decoded &frame : frames)
+    {
+        result.completed++;
+        if (IrDataPacket(Data.calculateCRC(frame.raw)).get_crc() != 0)
+            continue;
+        result.valid++;
+        if (decoded)
+            decoded->push_back(frame);
+        auto found = std::find(expected.begin() + next, expected.end(), frame.raw);
+        if (found != expected.end())
+        {
+            result.matched++;
+            next = found - expected.begin() + 1;
+        }
+    }
+    return result;
+}
+/* #endregion */
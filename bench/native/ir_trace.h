@@ -0,0 +1,63 @@
+#ifndef IR_TRACE_H
+#define IR_TRACE_H
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief ir edge traces for the host programs: encode, import, fuzz and replay
+ * a trace is the receiver output as level changes, the output is inverted:
+ * a mark pulls it low. times are in us from any start.
+ * encodeFrame is the reference encoder of the blaster frame in data.h, loadTrace
+ * reads logic analyzer exports: CSV (a time column in seconds and a 0/1 column per
+ * channel, Saleae and PulseView write these) and VCD (sigrok, Saleae, simulators).
+ * replayTrace hands the edges straight to DataReader::handlePinChange, no nativeHal
+ * in between, so the ns it reports are the decoder's alone.
+ */
+struct Edge
+{
+  uint32_t at; // [us]
+  bool level;
+};
+typedef std::vector<Edge> Trace;
+
+// one frame starting at t, 'skew' scales every time (a slow or fast RC clock), returns the time after the stop mark
+uint32_t encodeFrame(Trace &out, uint32_t t, uint32_t raw, float skew = 1.0f);
+
+// noise on the receiver output
+struct Fuzz
+{
+  uint16_t jitter;   // every edge moved by up to +-jitter [us]
+  uint16_t drops;    // marks lost [permille]
+  uint16_t spikes;   // 20..120 us low somewhere after a mark [permille of the marks]
+  uint16_t dropouts; // 20..120 us high inside a mark [permille of the marks]
+};
+void fuzzTrace(Trace &trace, const Fuzz &fuzz, std::mt19937 &rng);
+
+// CSV or VCD by the extension, 'channel' counts the one bit signals from 0, -1 takes the first one that has edges.
+// false and a message on stderr if it can't
+bool loadTrace(const char *path, Trace &trace, int channel = -1);
+// the frames a trace should decode to: hex, one per line, as sent (crc included)
+bool loadFrames(const char *path, std::vector<uint32_t> &frames);
+bool saveVcd(const char *path, const Trace &trace);
+bool saveCsv(const char *path, const Trace &trace);
+
+struct ReplayResult
+{
+  uint32_t edges;
+  uint16_t completed; // 32 bits in
+  uint16_t valid;     // and the crc checks out
+  uint16_t matched;   // of the expected frames, in order
+  double ns;          // wall clock in handlePinChange
+};
+// a frame that passed the crc, at the edge that completed it
+struct Decoded
+{
+  uint32_t at; // [us]
+  uint32_t raw;
+};
+// through a fresh DataReader, fixed or adaptive windows (IR_ADAPTIVE builds only), 'decoded' gets the valid frames
+ReplayResult replayTrace(const Trace &trace, const std::vector<uint32_t> &expected, bool adaptive,
+                         std::vector<Decoded> *decoded = nullptr);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef NAMED_PATTERNS_H
+#define NAMED_PATTERNS_H
+#include "patterns.h"
+
+/**
+ * @brief every pattern in src/main.cpp by name, enabled in gPatterns or not
+ * for the host programs: bench/native and tools/bake. the entries are the ones gPatterns takes
+ */
+struct NamedPattern
+{
+    const char *name;
+    Pattern pattern; // as it would be in gPatterns
+};
+
+#define NAMED_PATTERN(name) {#name, PATTERN_ENTRY(name)}
+static const NamedPattern patterns[] = {
+    NAMED_PATTERN(rainbowColors),
+    NAMED_PATTERN(partyColors),
+    NAMED_PATTERN(oceanColors),
+    NAMED_PATTERN(forestColors),
+    NAMED_PATTERN(paletteMorph),
+#if __has_include("baked_stream.h")
+    NAMED_PATTERN(bakedAnimation),
+#endif
+    NAMED_PATTERN(christmasSparkles),
+    NAMED_PATTERN(christmasSparklesRG),
+    NAMED_PATTERN(christmasSparklesBP),
+    NAMED_PATTERN(heart_beat_all),
+    NAMED_PATTERN(heart_beat_all_reverse),
+    NAMED_PATTERN(heart_beat_eyes_red),
+    NAMED_PATTERN(heart_beat_eyes_blue),
+    NAMED_PATTERN(heart_beat_eyes_mono),
+    NAMED_PATTERN(heart_beat_logo),
+};
+
+#endif
@@ -0,0 +1,419 @@
+/*
+ * cycle accurate benchmark of the attiny85 firmware under simavr
+ *
+ *   pio run -e attiny85_simavr
+ *   make -C bench/simavr
+ *   bench/simavr/ir_bench .pio/build/attiny85_simavr/firmware.elf bench/simavr/shots.txt
+ *
+ * the harness steps the core one instruction at a time and
+ *  - times every interrupt (PCINT0_vect, EE_RDY_vect of the hit log, the timers) from
+ *    the vector fetch up to and including its reti, and the latency from the PB4 edge
+ *    to the PCINT0 vector fetch
+ *  - times the BENCH_MARK_BEGIN/END sections (include/bench_mark.h) through GPIOR0 writes
+ *  - tracks the stack high-water mark, overall and inside each section
+ *  - counts the time the core idles in sleep, the wakes by interrupt vector and the
+ *    packets handle_ir_packet got, and estimates the supply current of the mcu
+ *  - follows the clock prescaler (CLKPR, src/clock.h): simavr counts cycles of the core
+ *    and its timers, the harness keeps the real time, the edges stay on it
+ *
+ * edge script, one command per line, '#' starts a comment:
+ *   wait <us>        let the firmware run
+ *   packet <hex>     send one blaster frame (9 ms start mark, 32 bits lsb first, stop) on PB4
+ *   level <0|1>      drive PB4 directly (the receiver output is idle high)
+ *   repeat <n>       replay everything above n more times
+ *   leds <n>         strip length of the firmware, adds us per led and the longest strip
+ *                    at 60 fps to the FastLED.show and streamFrame rows
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_io.h>
+#include <avr_ioport.h>
+
+#define F_CPU 8000000UL
+#define US(us) ((avr_cycle_count_t)(us) * (F_CPU / 1000000UL))
+
+#define IR_PIN 4              /* PB4, IR_IN1_PIN in data.h */
+#define PCINT0_VECTOR_ADDR 4  /* vector 2, byte address */
+#define GPIOR0_ADDR 0x31      /* io 0x11 in data space */
+#define CLKPR_ADDR 0x46       /* io 0x26 in data space */
+#define CLKPCE 0x80
+#define OPCODE_RETI 0x9518
+#define MARK_END 0x80
+#define MARK_READIR 0x01      /* eMarkReadIr */
+#define MARK_SHOW 0x02        /* eMarkShow */
+#define MARK_TRANSITION 0x03  /* eMarkTransition */
+#define MARK_STREAM 0x04      /* eMarkStream */
+#define MARK_HIT 0x05         /* eMarkHit */
+#define MARK_HITCACHE 0x06    /* eMarkHitCache */
+#define MARK_PATTERN 0x10     /* eMarkPattern */
+
+#define MAX_EVENTS 65536
+
+/* rough typical supply current of the attiny85 at 8 MHz and 3 V (datasheet curves), leds not included */
+#ifndef ACTIVE_UA
+#define ACTIVE_UA 3000
+#endif
+#ifndef IDLE_UA
+#define IDLE_UA 750
+#endif
+
+static const char *const vector_names[] = {
+    "RESET", "INT0", "PCINT0", "TIMER1_COMPA", "TIMER1_OVF", "TIMER0_OVF", "EE_RDY", "ANA_COMP",
+    "ADC", "TIMER1_COMPB", "TIMER0_COMPA", "TIMER0_COMPB", "WDT", "USI_START", "USI_OVF"};
+#define VECTORS (sizeof(vector_names) / sizeof(vector_names[0]))
+
+typedef struct
+{
+  avr_cycle_count_t at;
+  uint8_t level;
+} edge_t;
+
+typedef struct
+{
+  uint32_t count;
+  avr_cycle_count_t min, max, total;
+  uint16_t sp_min; /* lowest stack pointer seen, 0 = not tracked */
+} stat_t;
+
+static edge_t edges[MAX_EVENTS];
+static int edge_count;
+static unsigned long packets_sent;
+
+static stat_t marks[128];
+static avr_cycle_count_t mark_start[128];
+static stat_t isr_latency, isr_latency_show;
+static int in_show;
+static int open_mark = -1; /* section running right now */
+static uint16_t sp_min, ramend;
+static unsigned long num_leds;
+
+/* real time in cycles of the undivided 8 MHz clock (the script, edges[].at), on a divided
+ * clock a cycle of the core is 1 << clock_shift of them */
+static unsigned clock_shift;
+static avr_cycle_count_t base_cycle, base_time; /* at the last clock switch */
+static unsigned long clock_switches;
+static avr_cycle_count_t time_at[16][2]; /* real time per clock shift, [1] asleep */
+
+static avr_cycle_count_t now_time(const avr_t *avr)
+{
+  return base_time + ((avr->cycle - base_cycle) << clock_shift);
+}
+
+/* first cycle of the core at or after real time t */
+static avr_cycle_count_t cycle_at(avr_cycle_count_t t)
+{
+  return base_cycle + ((t - base_time + (1u << clock_shift) - 1) >> clock_shift);
+}
+
+/* the edges go in as cycle timers, so they land on time while the core sleeps */
+static avr_irq_t *ir_pin;
+static int next_edge;
+static avr_cycle_count_t edge_at;
+static int edge_pending;
+
+static void stat_add(stat_t *s, avr_cycle_count_t v)
+{
+  if (!s->count || v < s->min)
+    s->min = v;
+  if (v > s->max)
+    s->max = v;
+  s->total += v;
+  s->count++;
+}
+
+/* #region script */
+static void add_edge(avr_cycle_count_t at, uint8_t level)
+{
+  if (edge_count == MAX_EVENTS)
+  {
+    fprintf(stderr, "too many edges\n");
+    exit(1);
+  }
+  edges[edge_count].at = at;
+  edges[edge_count].level = level;
+  edge_count++;
+}
+
+/* a mark pulls the inverted receiver output low, the period runs falling to falling edge */
+static avr_cycle_count_t add_mark(avr_cycle_count_t t, uint32_t length_us, uint32_t period_us)
+{
+  add_edge(t, 0);
+  add_edge(t + US(length_us), 1);
+  return t + US(period_us);
+}
+
+static avr_cycle_count_t load_script(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+  {
+    perror(path);
+    exit(1);
+  }
+
+  char line[128];
+  avr_cycle_count_t t = US(1000);
+  while (fgets(line, sizeof(line), f))
+  {
+    char *comment = strchr(line, '#');
+    if (comment)
+      *comment = 0;
+    char cmd[16], arg[32];
+    if (sscanf(line, "%15s %31s", cmd, arg) != 2)
+      continue;
+
+    if (!strcmp(cmd, "wait"))
+    {
+      t += US(strtoul(arg, NULL, 10));
+    }
+    else if (!strcmp(cmd, "packet"))
+    {
+      uint32_t raw = strtoul(arg, NULL, 16);
+      packets_sent++;
+      t = add_mark(t, 9000, 13500); /* start: 16 units of 562.5 us on, 8 off */
+      for (int i = 0; i < 32; i++)
+        t = add_mark(t, 560, (raw >> i) & 1 ? 2250 : 1120);
+      t = add_mark(t, 560, 1120);
+    }
+    else if (!strcmp(cmd, "level"))
+    {
+      add_edge(t, strtoul(arg, NULL, 10) != 0);
+    }
+    else if (!strcmp(cmd, "leds"))
+    {
+      num_leds = strtoul(arg, NULL, 10);
+    }
+    else if (!strcmp(cmd, "repeat"))
+    {
+      unsigned long times = strtoul(arg, NULL, 10);
+      int n = edge_count;
+      packets_sent *= times + 1;
+      avr_cycle_count_t span = t - US(1000);
+      for (unsigned long r = 1; r <= times; r++)
+        for (int i = 0; i < n; i++)
+          add_edge(edges[i].at + span * r, edges[i].level);
+      t += span * times;
+    }
+  }
+  fclose(f);
+  return t;
+}
+/* #endregion */
+
+static avr_cycle_count_t edge_timer(struct avr_t *avr, avr_cycle_count_t when, void *param)
+{
+  (void)param;
+  avr_raise_irq(ir_pin, edges[next_edge].level);
+  edge_at = when;
+  edge_pending = 1;
+  next_edge++;
+  return next_edge < edge_count ? cycle_at(edges[next_edge].at) : 0;
+}
+
+/* the second write after CLKPCE sets the divider, the pending edge moves to the new cycle rate */
+static void clkpr_write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+  (void)param;
+  avr->data[addr] = v;
+  if (v & CLKPCE)
+    return;
+  base_time = now_time(avr);
+  base_cycle = avr->cycle;
+  if ((v & 0x0F) != clock_shift)
+    clock_switches++;
+  clock_shift = v & 0x0F;
+  if (next_edge < edge_count)
+  {
+    avr_cycle_timer_cancel(avr, edge_timer, NULL);
+    avr_cycle_timer_register(avr, cycle_at(edges[next_edge].at) - avr->cycle, edge_timer, NULL);
+  }
+}
+
+static void gpior0_write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+  (void)param;
+  avr->data[addr] = v;
+
+  uint8_t id = v & ~MARK_END;
+  if (v & MARK_END)
+  {
+    stat_add(&marks[id], avr->cycle - mark_start[id]);
+    open_mark = -1;
+    if (id == MARK_SHOW)
+      in_show = 0;
+  }
+  else
+  {
+    mark_start[id] = avr->cycle;
+    open_mark = id;
+    if (id == MARK_SHOW)
+      in_show = 1;
+  }
+}
+
+static void print_stat(const char *name, const stat_t *s)
+{
+  if (!s->count)
+    return;
+  printf("  %-24s %8u %8llu %10.1f %8llu %10.1f", name, s->count,
+         (unsigned long long)s->min, (double)s->total / s->count, (unsigned long long)s->max,
+         s->max * 1e6 / F_CPU);
+  if (s->sp_min)
+    printf(" %6u", ramend - s->sp_min);
+  printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: %s firmware.elf script.txt [extra_ms]\n", argv[0]);
+    return 1;
+  }
+
+  elf_firmware_t firmware = {0};
+  if (elf_read_firmware(argv[1], &firmware))
+  {
+    fprintf(stderr, "can't load %s\n", argv[1]);
+    return 1;
+  }
+  avr_t *avr = avr_make_mcu_by_name("attiny85");
+  avr_init(avr);
+  avr_load_firmware(avr, &firmware);
+  avr->frequency = F_CPU; /* lfuse 0xE2, internal 8 MHz rc */
+  avr->log = LOG_ERROR;
+  ramend = avr->ramend;
+  sp_min = ramend;
+
+  avr_register_io_write(avr, GPIOR0_ADDR, gpior0_write, NULL);
+  avr_register_io_write(avr, CLKPR_ADDR, clkpr_write, NULL);
+  ir_pin = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), IR_PIN);
+  avr_raise_irq(ir_pin, 1);
+
+  avr_cycle_count_t end = load_script(argv[2]) + US(1000UL * (argc > 3 ? atoi(argv[3]) : 100));
+  if (edge_count)
+    avr_cycle_timer_register(avr, cycle_at(edges[0].at) - avr->cycle, edge_timer, NULL);
+  avr_cycle_count_t isr_start = 0;
+  int in_isr = 0; /* vector number, ISRs don't nest */
+  stat_t isr_cycles[VECTORS] = {{0}};
+  unsigned long wakes[VECTORS] = {0}, wakes_other = 0;
+  int woke = 0;
+
+  while (now_time(avr) < end)
+  {
+    avr_flashaddr_t pc = avr->pc;
+    if (woke)
+    {
+      /* the first instruction after a wake is the vector of the interrupt that ended it */
+      if (pc / 2 < VECTORS)
+        wakes[pc / 2]++;
+      else
+        wakes_other++;
+      woke = 0;
+    }
+    int reti = in_isr && (avr->flash[pc] | (avr->flash[pc + 1] << 8)) == OPCODE_RETI;
+    if (!in_isr && pc && pc % 2 == 0 && pc / 2 < VECTORS)
+    {
+      in_isr = pc / 2;
+      isr_start = avr->cycle;
+      if (pc == PCINT0_VECTOR_ADDR && edge_pending)
+      {
+        stat_add(in_show ? &isr_latency_show : &isr_latency, avr->cycle - edge_at);
+        edge_pending = 0;
+      }
+    }
+
+    uint16_t sp = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+    if (sp < sp_min)
+      sp_min = sp;
+    if (open_mark >= 0 && (!marks[open_mark].sp_min || sp < marks[open_mark].sp_min))
+      marks[open_mark].sp_min = sp;
+
+    int sleeping = avr->state == cpu_Sleeping;
+    unsigned shift = clock_shift;
+    avr_cycle_count_t before = avr->cycle;
+    int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed)
+    {
+      fprintf(stderr, "cpu stopped at pc 0x%04x\n", avr->pc);
+      return 1;
+    }
+    time_at[shift][sleeping] += (avr->cycle - before) << shift;
+    if (sleeping)
+      woke = state != cpu_Sleeping;
+
+    if (reti)
+    {
+      stat_add(&isr_cycles[in_isr], avr->cycle - isr_start);
+      in_isr = 0;
+    }
+  }
+
+  double seconds = now_time(avr) / (double)F_CPU;
+  printf("simavr attiny85 @ %lu Hz, %d edges, %.1f ms simulated\n", F_CPU, edge_count, seconds * 1e3);
+  printf("stack high-water %u of %u bytes of ram\n", ramend - sp_min, ramend + 1 - 0x60);
+  printf("  %-24s %8s %8s %10s %8s %10s %6s\n", "cycles", "count", "min", "avg", "max", "max us", "stack");
+  for (unsigned i = 1; i < VECTORS; i++)
+  {
+    char name[24];
+    snprintf(name, sizeof(name), "%s_vect", vector_names[i]);
+    print_stat(name, &isr_cycles[i]);
+  }
+  print_stat("edge->ISR latency", &isr_latency);
+  print_stat("edge->ISR during show", &isr_latency_show);
+  print_stat("_data::readIr", &marks[MARK_READIR]);
+  print_stat("FastLED.show", &marks[MARK_SHOW]);
+  print_stat("render_transition", &marks[MARK_TRANSITION]);
+  print_stat("streamFrame", &marks[MARK_STREAM]);
+  print_stat("handle_ir_packet", &marks[MARK_HIT]);
+  print_stat("HitCache::accept", &marks[MARK_HITCACHE]);
+  for (int i = MARK_PATTERN; i < MARK_END; i++)
+  {
+    char name[24];
+    snprintf(name, sizeof(name), "gPatterns[%d]", i - MARK_PATTERN);
+    print_stat(name, &marks[i]);
+  }
+
+  /* a packet that made it through the decoder and the crc ends up in handle_ir_packet */
+  printf("ir: %u of %lu packets handled\n", marks[MARK_HIT].count, packets_sent);
+
+  /* the share of the time the core ran or slept at each clock sets the mcu current,
+   * both currents taken as linear in the clock */
+  double total = now_time(avr), awake = 0, ua = 0;
+  printf("time per clock, %lu switches (%.1f/s)\n", clock_switches, clock_switches / seconds);
+  for (unsigned shift = 0; shift < 16; shift++)
+  {
+    if (!time_at[shift][0] && !time_at[shift][1])
+      continue;
+    double run = time_at[shift][0] / total, idle = time_at[shift][1] / total;
+    char name[24];
+    snprintf(name, sizeof(name), "%lu kHz", (F_CPU / 1000) >> shift);
+    printf("  %-24s %7.1f%% awake %7.1f%% asleep\n", name, run * 100, idle * 100);
+    awake += run;
+    ua += run * (ACTIVE_UA >> shift) + idle * (IDLE_UA >> shift);
+  }
+  printf("awake %.1f%% of the time, mcu %.2f mA average (%.2f mA awake, %.2f mA idle at 8 MHz)\n", awake * 100,
+         ua / 1000, ACTIVE_UA / 1000.0, IDLE_UA / 1000.0);
+  for (unsigned i = 0; i < VECTORS; i++)
+    if (wakes[i])
+      printf("  %-24s %8lu wakes %8.1f/s\n", vector_names[i], wakes[i], wakes[i] / seconds);
+  if (wakes_other)
+    printf("  %-24s %8lu wakes\n", "no vector", wakes_other);
+
+  /* the whole frame goes out in the marked section, the longest strip is where it takes 1/60 s */
+  const int frame_marks[] = {MARK_SHOW, MARK_STREAM};
+  for (int i = 0; num_leds && i < 2; i++)
+  {
+    const stat_t *s = &marks[frame_marks[i]];
+    if (!s->count)
+      continue;
+    double us_per_led = s->max * 1e6 / F_CPU / num_leds;
+    printf("  %-24s %8.1f us/led, %lu leds at 60 fps\n", frame_marks[i] == MARK_SHOW ? "FastLED.show" : "streamFrame",
+           us_per_led, (unsigned long)(1e6 / 60 / us_per_led));
+  }
+  return 0;
+}
@@ -0,0 +1,59 @@
+// generated by tools/bake from heart_beat_eyes_blue, 1104 ms from 1100 ms on, do not edit
+// only included by src/main.cpp
+// layout: hat
+#ifndef BAKED_STREAM_H
+#define BAKED_STREAM_H
+
+#define BAKED_LEDS 10
+#define BAKED_FRAMES 69
+#define BAKED_FRAME_MS 16
+
+const uint8_t bakedColors[][3] PROGMEM =
+{
+    {0, 0, 0}, {0, 0, 7}, {0, 0, 22}, {0, 0, 62}, {0, 0, 138}, {0, 0, 219},
+    {0, 0, 252}, {0, 0, 212}, {0, 0, 177}, {0, 0, 149}, {0, 0, 2}, {0, 0, 125},
+    {0, 0, 105}, {0, 0, 88}, {0, 0, 3}, {0, 0, 74}, {0, 0, 5}, {0, 0, 15},
+    {0, 0, 51}, {0, 0, 43}, {0, 0, 107}, {0, 0, 36}, {0, 0, 194}, {0, 0, 30},
+    {0, 0, 246}, {0, 0, 25}, {0, 0, 21}, {0, 0, 182}, {0, 0, 18}, {0, 0, 156},
+    {0, 0, 135}, {0, 0, 13}, {0, 0, 116}, {0, 0, 11}, {0, 0, 99}, {0, 0, 9},
+    {0, 0, 85}, {0, 0, 8}, {0, 0, 73}, {0, 0, 63}, {0, 0, 6}, {0, 0, 54},
+    {0, 0, 46}, {0, 0, 4}, {0, 0, 40}, {0, 0, 35}, {0, 0, 26}, {0, 0, 19},
+    {0, 0, 17}, {0, 0, 14}, {0, 0, 12},
+};
+
+// (count, color) runs, BAKED_LEDS pixels per frame
+const uint8_t bakedRuns[] PROGMEM =
+{
+    4, 0, 1, 1, 5, 0, 4, 0, 1, 2, 5, 0, 4, 0, 1, 3,
+    5, 0, 4, 0, 1, 4, 5, 0, 4, 0, 1, 5, 5, 0, 4, 0,
+    1, 6, 5, 0, 4, 0, 1, 7, 5, 0, 4, 0, 1, 8, 5, 0,
+    4, 0, 1, 9, 1, 10, 4, 0, 4, 0, 1, 11, 1, 10, 4, 0,
+    4, 0, 1, 12, 1, 10, 4, 0, 4, 0, 1, 13, 1, 14, 4, 0,
+    4, 0, 1, 15, 1, 16, 4, 0, 4, 0, 1, 3, 1, 17, 4, 0,
+    4, 0, 1, 18, 1, 19, 4, 0, 4, 0, 1, 19, 1, 20, 4, 0,
+    4, 0, 1, 21, 1, 22, 4, 0, 4, 0, 1, 23, 1, 24, 4, 0,
+    4, 0, 1, 25, 1, 7, 4, 0, 4, 0, 1, 26, 1, 27, 4, 0,
+    4, 0, 1, 28, 1, 29, 4, 0, 4, 0, 1, 17, 1, 30, 4, 0,
+    4, 0, 1, 31, 1, 32, 4, 0, 4, 0, 1, 33, 1, 34, 4, 0,
+    4, 0, 1, 35, 1, 36, 4, 0, 4, 0, 1, 37, 1, 38, 4, 0,
+    4, 0, 1, 1, 1, 39, 4, 0, 4, 0, 1, 40, 1, 41, 4, 0,
+    4, 0, 1, 16, 1, 42, 4, 0, 4, 0, 1, 43, 1, 44, 4, 0,
+    4, 0, 1, 43, 1, 45, 4, 0, 4, 0, 1, 14, 1, 23, 4, 0,
+    4, 0, 1, 14, 1, 46, 4, 0, 4, 0, 1, 14, 1, 2, 4, 0,
+    4, 0, 1, 14, 1, 47, 4, 0, 4, 0, 1, 10, 1, 48, 4, 0,
+    4, 0, 1, 10, 1, 49, 4, 0, 4, 0, 1, 10, 1, 50, 4, 0,
+    4, 0, 1, 10, 1, 33, 4, 0, 4, 0, 1, 10, 1, 35, 4, 0,
+    4, 0, 1, 10, 1, 37, 4, 0, 4, 0, 1, 10, 1, 1, 4, 0,
+    4, 0, 1, 10, 1, 40, 4, 0, 4, 0, 1, 10, 1, 16, 4, 0,
+    4, 0, 1, 10, 1, 16, 4, 0, 4, 0, 1, 10, 1, 43, 4, 0,
+    4, 0, 1, 10, 1, 43, 4, 0, 4, 0, 1, 10, 1, 14, 4, 0,
+    5, 0, 1, 14, 4, 0, 5, 0, 1, 14, 4, 0, 5, 0, 1, 14,
+    4, 0, 5, 0, 1, 10, 4, 0, 5, 0, 1, 10, 4, 0, 5, 0,
+    1, 10, 4, 0, 5, 0, 1, 10, 4, 0, 5, 0, 1, 10, 4, 0,
+    5, 0, 1, 10, 4, 0, 5, 0, 1, 10, 4, 0, 5, 0, 1, 10,
+    4, 0, 5, 0, 1, 10, 4, 0, 5, 0, 1, 10, 4, 0, 5, 0,
+    1, 10, 4, 0, 5, 0, 1, 10, 4, 0, 5, 0, 1, 10, 4, 0,
+    5, 0, 1, 10, 4, 0, 10, 0, 10, 0, 10, 0, 10, 0,
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef BENCH_MARK_H
+#define BENCH_MARK_H
+#include <Arduino.h>
+
+/**
+ * @brief cycle markers for the simavr benchmark (bench/simavr)
+ * built with -DSIMAVR_BENCH ([env:attiny85_simavr]) a marker is a single
+ * `out GPIOR0` the harness timestamps with the simulated cycle counter,
+ * otherwise they compile to nothing.
+ * a begin writes the id, the matching end writes id | 0x80.
+ */
+enum BenchMarkId : uint8_t
+{
+  eMarkReadIr = 0x01,
+  eMarkShow = 0x02,
+  eMarkTransition = 0x03,
+  eMarkStream = 0x04,
+  eMarkHit = 0x05,      // handle_ir_packet, once per packet readIr handed out
+  eMarkHitCache = 0x06, // HitCache::accept, inside eMarkHit
+  eMarkPattern = 0x10,  // + gCurrentPatternNumber
+};
+
+#if defined(SIMAVR_BENCH) && !defined(NATIVE_HAL)
+#define BENCH_MARK_BEGIN(id) (GPIOR0 = (id))
+#define BENCH_MARK_END(id) (GPIOR0 = (id) | 0x80)
+#else
+#define BENCH_MARK_BEGIN(id)
+#define BENCH_MARK_END(id)
+#endif
+
+#endif
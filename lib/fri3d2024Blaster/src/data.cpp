@@ -1,93 +1,333 @@
 #include "data.h"
 #include <Arduino.h>
 
+/* #region timestamps */
+#if IR_TIMER1
+static volatile uint8_t timer1High; // Timer1 overflows, the high byte of the tick count
 
+// call with interrupts off (in the ISR, or under cli())
+static inline ir_time_t irNow()
+{
+    uint8_t low = TCNT1;
+    uint8_t high = timer1High;
+    if ((TIFR & _BV(TOV1)) && low < 0x80)
+        high++; // wrapped, but the overflow interrupt didn't run yet
+    return ((uint16_t)high << 8) | low;
+}
+#else
+static inline ir_time_t irNow()
+{
+    return micros();
+}
+#endif
+/* #endregion */
 
-IrDataPacket::IrDataPacket(){};
-IrDataPacket::IrDataPacket(uint32_t raw){this->raw=raw;};
+/* #region CRC tables */
+// one CRC-8 step over a byte: n * x^8 mod (x^8 + x^2 + x + 1)
+constexpr uint8_t crc8_shift(uint8_t crc, uint8_t bits)
+{
+    return bits == 0 ? crc : crc8_shift((crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1), bits - 1);
+}
+constexpr uint8_t crc8_entry(uint8_t n) { return crc8_shift(n, 8); }
+static_assert(crc8_entry(0x01) == 0x07 && crc8_entry(0x80) == 0x89, "CRC-8 poly 0x07");
 
-uint32_t IrDataPacket::get_raw()         { return this->raw; }
-uint8_t IrDataPacket::get_channel()      { return (this->raw & 0b00000000000000000000000000000001) >> 0; }
-uint8_t IrDataPacket::get_team()         { return (this->raw & 0b00000000000000000000000000001110) >> 1; }
-uint8_t IrDataPacket::get_action()       { return (this->raw & 0b00000000000000000000000000110000) >> 4; }
-uint8_t IrDataPacket::get_action_param() { return (this->raw & 0b00000000000000000000001111000000) >> 6; }
-uint16_t IrDataPacket::get_player_id()   { return (this->raw & 0b00000000001111111111110000000000) >> 10; }
-uint8_t IrDataPacket::get_crc()          { return (this->raw & 0b00111111110000000000000000000000) >> 22; }
+#define CRC8_ROW4(n) crc8_entry(n), crc8_entry(n + 1), crc8_entry(n + 2), crc8_entry(n + 3)
+#define CRC8_ROW16(n) CRC8_ROW4(n), CRC8_ROW4(n + 4), CRC8_ROW4(n + 8), CRC8_ROW4(n + 12)
+#define CRC8_ROW64(n) CRC8_ROW16(n), CRC8_ROW16(n + 16), CRC8_ROW16(n + 32), CRC8_ROW16(n + 48)
 
-void IrDataPacket::set_raw(uint32_t raw)                  { this->raw = raw; }
-void IrDataPacket::set_channel(uint8_t channel)           { this->raw &= ~(0b1 << 0); this->raw |= (channel & 0b1) << 0;}
-void IrDataPacket::set_team(uint8_t team)                 { this->raw &= ~(0b111 << 1); this->raw |= (team & 0b111) << 1;}
-void IrDataPacket::set_action(uint8_t action)             { this->raw &= ~(0b11 << 4); this->raw |= (action & 0b11) << 4;}
-void IrDataPacket::set_action_param(uint8_t action_param) { this->raw &= ~(0b1111 << 6); this->raw |= (action_param & 0b1111) << 6;}
-void IrDataPacket::set_player_id(uint16_t player_id)      { this->raw &= ~(0b111111111111 << 10); this->raw |= (player_id & 0b111111111111) << 10;}
-void IrDataPacket::set_crc(uint8_t crc)                   { this->raw &= ~(0b11111111 << 22); this->raw |= (crc & 0b11111111) << 22;}
-void IrDataPacket::set_unused(uint8_t unused)             { this->raw &= ~(0b11 << 30); this->raw |= (unused & 0b11) << 30;}
+#if IR_CRC_BYTE_TABLE
+static const uint8_t crc8_table[256] PROGMEM = {CRC8_ROW64(0), CRC8_ROW64(64), CRC8_ROW64(128), CRC8_ROW64(192)};
+#else
+// 16 entries: the high nibble of the crc and the next data nibble index the table
+static const uint8_t crc8_nibbles[16] PROGMEM = {CRC8_ROW16(0)};
 
+static inline uint8_t crc8_nibble(uint8_t crc, uint8_t data)
+{
+    crc = (crc << 4) ^ pgm_read_byte(&crc8_nibbles[(crc >> 4) ^ (data >> 4)]);
+    return (crc << 4) ^ pgm_read_byte(&crc8_nibbles[(crc >> 4) ^ (data & 0x0F)]);
+}
+#endif
+/* #endregion */
+
+/* #region telemetry */
+static inline uint8_t irAdd(uint8_t a, uint8_t b)
+{
+    return a + b > 0xFF ? 0xFF : a + b;
+}
+
+#if IR_TELEMETRY
+#define IR_COUNT(counter) count_saturating(counter)
+#else
+#define IR_COUNT(counter)
+#endif
+
+#if IR_HISTOGRAM
+static_assert((IR_TICKS(IR_HISTOGRAM_BIN_US) & (IR_TICKS(IR_HISTOGRAM_BIN_US) - 1)) == 0, "histogram bins must be a power of two of ticks");
+static IrHistogram histogram;
+static volatile bool capturing;
+
+static inline void histogramAdd(ir_time_t delta_time)
+{
+    ir_time_t bin = delta_time / IR_TICKS(IR_HISTOGRAM_BIN_US);
+    uint16_t &count = histogram.bins[bin < IR_HISTOGRAM_BINS ? bin : IR_HISTOGRAM_BINS];
+    count_saturating(count);
+}
+#endif
+/* #endregion */
+
+/* #region bit windows */
+static constexpr IrWindows ir_fixed_windows = {
+    IR_TICKS(1120 * 0.8), IR_TICKS(1120 / 0.8),
+    IR_TICKS(2250 * 0.8), IR_TICKS(2250 / 0.8)};
+#if IR_TIMER1
+// both bit windows end below 256 ticks, compare a single byte
+static_assert(IR_TICKS(2250 / IR_START_TOLERANCE * IR_ONE_MAX) <= 0xFF, "bit windows must fit 8 bit ticks");
+#define IR_START_SHIFT 2
+#else
+#define IR_START_SHIFT 6
+#endif
+// the start pulse scaled down so the products below stay 16 bit
+static_assert(IR_TICKS(13500 / IR_START_TOLERANCE) >> IR_START_SHIFT <= 0xFFFF / 171, "start pulse too long for 16 bit");
+
+#if IR_ADAPTIVE
+bool DataReader::adaptive = true;
+
+// the bit times scale with the start pulse this frame came with
+void DataReader::learnWindows(ir_time_t start)
+{
+    uint16_t s = start >> IR_START_SHIFT;
+    ir_bit_time_t zero = (uint16_t)(s * 85U) >> (10 - IR_START_SHIFT); // 1120 / 13500 = 85 / 1024
+    ir_bit_time_t one = (uint16_t)(s * 171U) >> (10 - IR_START_SHIFT); // 2250 / 13500 = 171 / 1024
+    windows.zeroMin = zero - (zero >> 2) - (zero >> 3); // IR_ZERO_MIN
+    windows.zeroMax = windows.oneMin = ((uint16_t)zero + one) / 2;
+    windows.oneMax = one + (one >> 2); // IR_ONE_MAX
+}
+
+void DataReader::fixWindows()
+{
+    windows = ir_fixed_windows;
+}
+#endif
+/* #endregion */
 
 /* #region DataReader */
-void DataReader::handlePinChange(bool state)
+// the ISR is the single producer
+void DataReader::push()
 {
-    if (dataReady)
-        return; // don't read more data until the "buffer" is empty
-    if (state == oldState)
-        return;       // if the state didn't change then don't do anything. this happens if an other pin caused the interrupt
-    oldState = state; // update the oldState value so we can detect the next pin change.
+    if (queue.full())
+    {
+        count_saturating(overflows);
+    }
+    else
+    {
+        queue.back() = rawData;
+        queue.push(); // publish after the slot is written
+    }
+}
+
+uint32_t DataReader::lastFrame()
+{
+    return rawData;
+}
+
+bool DataReader::handlePinChange(bool state, ir_time_t time)
+{
+#if IR_ADAPTIVE
+    if (adaptive)
+    {
+        if (!state)
+        {
+            if (bitsRead != 0 && (ir_time_t)(time - refTime) <= windows.zeroMin)
+            {
+                IR_COUNT(rejected[eRejectGlitch]); // a dropout in the last mark, or noise right after it
+                return false;
+            }
+            markAt = time;
+            markPending = true;
+            stale = false;
+            return false;
+        }
+        if (!markPending)
+            return false;
+        markPending = false;
+        if ((ir_time_t)(time - markAt) < IR_TICKS(IR_GLITCH_US))
+        {
+            IR_COUNT(rejected[eRejectGlitch]); // a spike, not a mark
+            return false;
+        }
+        return fallingEdge(markAt);
+    }
+#endif
     if (state)
-        return;               // we are looking for a rising edge, but the signal is inverted so a falling edge is what we want.
-    uint32_t time = micros(); // check time passed since boot up.
-    uint32_t delta_time = time - refTime;
+        return false; // we are looking for a rising edge, but the signal is inverted so a falling edge is what we want.
+    return fallingEdge(time);
+}
+
+bool DataReader::fallingEdge(ir_time_t time)
+{
+    ir_time_t delta_time = time - refTime;
     refTime = time;
+    stale = false;
+#if IR_HISTOGRAM
+    if (capturing)
+        histogramAdd(delta_time);
+#endif
 
     /* if delta_time == 4500 set Ack state to true
        ack state resets after a send
     */
 
+#if IR_ADAPTIVE
+    const IrWindows &w = windows;
+    bool start = adaptive ? delta_time > IR_TICKS(13500 * IR_START_TOLERANCE) && delta_time < IR_TICKS(13500 / IR_START_TOLERANCE)
+                          : delta_time > IR_TICKS(13500 * 0.8) && delta_time < IR_TICKS(13500 / 0.8);
+#else
+    const IrWindows &w = ir_fixed_windows; // immediates
+    bool start = delta_time > IR_TICKS(13500 * 0.8) && delta_time < IR_TICKS(13500 / 0.8);
+#endif
+
     /* Check total pulse length (rising to rising edge) allow for some deviation*/
-    if (delta_time > (uint32_t)(13500 * 0.8) && delta_time < (uint32_t)(13500 / 0.8))
+    if (start)
     {
         bitsRead = 1;
         rawData = 0;
-        return;
+        IR_COUNT(started);
+#if IR_ADAPTIVE
+        if (adaptive)
+            learnWindows(delta_time);
+#endif
+        return false;
     }
     if (bitsRead == 0)
-        return;
+    {
+        IR_COUNT(idle);
+        return false;
+    }
 
-    if (delta_time > (uint32_t)(2250 * 0.8) && delta_time < (uint32_t)(2250 / 0.8))
+#if IR_TIMER1
+    if (delta_time > 0xFF)
+    {
+        IR_COUNT(rejected[eRejectLong]);
+        return false;
+    }
+#endif
+    ir_bit_time_t bit_time = delta_time;
+
+    if (bit_time > w.oneMin && bit_time < w.oneMax)
     {
         rawData = rawData >> 1; // make room for an extra bit
         rawData |= 0x80000000;  // set left bit high
         if (++bitsRead == (ir_bit_lenght + 1))
         {
-            dataReady = 1;
+            bitsRead = 0; // wait for the next start pulse
+            IR_COUNT(completed);
+            return true;
         }
     }
-    else if (delta_time > (uint32_t)(1120 * 0.8) && delta_time < (uint32_t)(1120 / 0.8))
+    else if (bit_time > w.zeroMin && bit_time < w.zeroMax)
     {
         rawData = rawData >> 1; // make room for an extra bit
         if (++bitsRead == (ir_bit_lenght + 1))
         {
-            dataReady = 1;
+            bitsRead = 0; // wait for the next start pulse
+            IR_COUNT(completed);
+            return true;
         }
     }
+#if IR_TELEMETRY
+    else if (bit_time <= w.zeroMin)
+        IR_COUNT(rejected[eRejectShort]);
+    else if (bit_time <= w.oneMin)
+        IR_COUNT(rejected[eRejectBetween]);
+    else
+        IR_COUNT(rejected[eRejectLong]);
+#endif
+    return false;
 }
 void DataReader::reset()
 {
-    rawData = 0;
+    uint8_t sreg = SREG;
+    cli(); // bitsRead and markPending belong to the ISR, loop() calls this through flushIr
     bitsRead = 0;
-    dataReady = 0;
+#if IR_ADAPTIVE
+    markPending = false;
+    if (!adaptive)
+        fixWindows();
+#endif
+    queue.drop();
+    SREG = sreg;
 }
 bool DataReader::isDataReady()
 {
-    return dataReady;
+    return !queue.empty();
 }
 
 uint32_t DataReader::getPacket()
 {
-    uint32_t p;
-    p = rawData;
-    reset();
+    uint32_t p = queue.front();
+    queue.pop(); // hand the slot back to the ISR only after it is read
     return p;
 }
+
+uint8_t DataReader::getOverflowCount()
+{
+    return overflows;
+}
+
+// the tick difference wraps (16 bit Timer1 ticks after 1.05 s): once it has been seen past the longest
+// start pulse the edge stays old until the ISR takes a new one, loop() asks every frame so it sees that in time
+uint32_t DataReader::sinceEdge()
+{
+    uint8_t sreg = SREG;
+    cli(); // refTime is wider than a byte, don't let the ISR change it halfway
+    ir_time_t last = refTime;
+#if IR_ADAPTIVE
+    if (markPending)
+        last = markAt; // refTime only follows on the rising edge, the bit windows count from the fall
+#endif
+    uint32_t since = (uint32_t)(ir_time_t)(irNow() - last) * IR_TICK_US;
+    if (since >= ir_start_max_us)
+        stale = true;
+    bool old = stale;
+    SREG = sreg;
+    return old ? ir_start_max_us : since;
+}
+
+// a falling edge before the 0 window opens is noise to the decoder (the adaptive one drops it as a glitch),
+// the blaster's next one comes later. with the windows learned from a frame's start pulse that is 700 us
+// for one on time, only a blaster 30 % fast gets down to ir_bit_min_us
+uint32_t DataReader::bitGap()
+{
+#if IR_ADAPTIVE
+    uint8_t sreg = SREG;
+    cli(); // the windows are wider than a byte with micros() timestamps, the ISR learns them from a start pulse
+    ir_bit_time_t zero_min = windows.zeroMin;
+    SREG = sreg;
+#else
+    ir_bit_time_t zero_min = ir_fixed_windows.zeroMin;
+#endif
+    return (uint32_t)zero_min * IR_TICK_US;
+}
+
+uint8_t DataReader::getBitsRead()
+{
+    return bitsRead;
+}
+
+#if IR_TELEMETRY
+void DataReader::takeCounters(IrTelemetry &telemetry)
+{
+    telemetry.framesStarted = irAdd(telemetry.framesStarted, started);
+    telemetry.framesCompleted = irAdd(telemetry.framesCompleted, completed);
+    telemetry.idleEdges = irAdd(telemetry.idleEdges, idle);
+    for (uint8_t reason = 0; reason < eRejectReasons; reason++)
+    {
+        telemetry.rejected[reason] = irAdd(telemetry.rejected[reason], rejected[reason]);
+        rejected[reason] = 0;
+    }
+    started = completed = idle = 0;
+}
+#endif
 /* #endregion */
 
 /* #region Data */
@@ -95,45 +335,215 @@ uint32_t DataReader::getPacket()
 // Private
 _data::_data()
 {
-    ir1_reader.reset();
+    for (DataReader &reader : readers)
+        reader.reset();
 
     enableReceive();
 }
 
 void _data::enableReceive()
 {
-    // Enable Pin Change Interrupt for PB4 (PCINT4)
+    // Enable Pin Change Interrupt for the receiver pins (PB4 = PCINT4, ...)
     // Set the PCIE0 bit in the GIMSK register to enable PCINT0..PCINT5 interrupts
     GIMSK |= (1 << PCIE);
 
-    // Enable the specific pin change interrupt for PB4 (PCINT4)
-    // Set the PCINT4 bit in the PCMSK register to enable the pin change interrupt for PB4
-    //   PCMSK |= (1 << PCINT4);
-    PCMSK |= 0b00010000; // turn on PCINT4
+    // Enable the specific pin change interrupts, PCINTn is PBn
+    PCMSK |= ir_receiver_mask();
 
-    pinMode(IR_IN1_PIN, INPUT);
+    for (uint8_t pin : ir_receiver_pins)
+        pinMode(pin, INPUT);
+    pinState = PINB;
 }
 
 void _data::disableReceive()
 {
-    PCMSK &= ~0b00010000; // turn off PCINT4
-    ir1_reader.reset();
+    PCMSK &= ~ir_receiver_mask(); // turn off the receiver PCINTs
+    flushIr();
 }
 
 // Public
 IrDataPacket _data::readIr() // add overload to bypass command type validation?
 {
-    if (ir1_reader.isDataReady())
+    IrDataPacket p(0);
+    readIr(&p, 1);
+    return p;
+}
+
+uint8_t _data::readIr(IrDataPacket *packets, uint8_t max_packets)
+{
+    // one frame from each receiver in turn, so none of them waits behind another
+    uint8_t count = 0;
+    bool more = true;
+    while (more && count < max_packets)
     {
-        IrDataPacket p(ir1_reader.getPacket());
-        p.set_raw(calculateCRC(p.get_raw()));
-        if (p.get_crc() == 0)
+        more = false;
+        for (DataReader &reader : readers)
         {
-            return p;
+            if (count == max_packets || !reader.isDataReady())
+                continue;
+            more = true;
+            IrDataPacket p(calculateCRC(reader.getPacket()));
+            if (p.get_crc() == 0)
+            {
+                packets[count++] = p;
+#if IR_TELEMETRY
+                count_saturating(teams[p.get_team()]);
+                count_saturating(actions[p.get_action()]);
+#endif
+            }
+#if IR_TELEMETRY
+            else
+            {
+                count_saturating(crcFailures);
+            }
+#endif
         }
     }
+    received += count;
+    return count;
+}
+
+void _data::flushIr()
+{
+    for (DataReader &reader : readers)
+        reader.reset();
+}
+
+uint8_t _data::getOverflowCount()
+{
+    uint16_t overflows = 0;
+    for (DataReader &reader : readers)
+        overflows += reader.getOverflowCount();
+    return overflows > 0xFF ? 0xFF : overflows;
+}
+
+uint16_t _data::getReceivedCount()
+{
+    return received;
+}
+
+uint8_t _data::getDuplicateCount()
+{
+    return duplicates;
+}
+
+uint8_t _data::getPinChangeCount()
+{
+    return pinChanges;
+}
+
+#if IR_TELEMETRY
+void _data::takeTelemetry(IrTelemetry &telemetry)
+{
+    memset(&telemetry, 0, sizeof(telemetry));
+    uint8_t sreg = SREG;
+    cli(); // the ISR counters are read and cleared in one go
+    for (DataReader &reader : readers)
+        reader.takeCounters(telemetry);
+    SREG = sreg;
+
+    // the queue and duplicate counters run since power on, hand out the difference
+    uint8_t overflows = getOverflowCount();
+    telemetry.overruns = overflows - overflowMark;
+    overflowMark = overflows;
+    telemetry.duplicates = duplicates - duplicateMark;
+    duplicateMark = duplicates;
+
+    telemetry.crcFailures = crcFailures;
+    crcFailures = 0;
+    memcpy(telemetry.teams, teams, sizeof(teams));
+    memset(teams, 0, sizeof(teams));
+    memcpy(telemetry.actions, actions, sizeof(actions));
+    memset(actions, 0, sizeof(actions));
+}
+#endif
+
+#if IR_ADAPTIVE
+void _data::setAdaptive(bool adaptive)
+{
+    uint8_t sreg = SREG;
+    cli();
+    DataReader::adaptive = adaptive;
+    for (DataReader &reader : readers)
+        reader.reset(); // a frame half in is lost either way
+    SREG = sreg;
+}
+#endif
+
+#if IR_HISTOGRAM
+void _data::startCapture()
+{
+    uint8_t sreg = SREG;
+    cli();
+    memset(&histogram, 0, sizeof(histogram));
+    capturing = true;
+    SREG = sreg;
+}
+
+void _data::stopCapture()
+{
+    capturing = false;
+}
+
+void _data::readHistogram(IrHistogram &copy)
+{
+    uint8_t sreg = SREG;
+    cli(); // the bins are 16 bit
+    memcpy(&copy, &histogram, sizeof(histogram));
+    SREG = sreg;
+}
+#endif
+
+bool _data::frameInProgress()
+{
+    for (DataReader &reader : readers)
+    {
+        // no edge for longer than a bit means the frame is lost, not in progress
+        if (reader.getBitsRead() && reader.sinceEdge() < ir_bit_max_us)
+            return true;
+    }
+    return false;
+}
 
-    return IrDataPacket(0);
+uint32_t _data::remainingAirtime()
+{
+    uint32_t longest = 0;
+    for (DataReader &reader : readers)
+    {
+        uint8_t bits = reader.getBitsRead();
+        uint32_t since = reader.sinceEdge();
+        if (bits == 0 || since >= ir_bit_max_us)
+            continue;
+        // every bit left may still be a long one, plus the stop mark.
+        // past that the frame lost an edge, nothing more to wait for
+        uint32_t worst = (uint32_t)(ir_bit_lenght + 1 - bits) * 2250 + 1120;
+        if (since >= worst)
+            continue;
+        if (worst - since > longest)
+            longest = worst - since;
+    }
+    return longest;
+}
+
+bool _data::canShow(uint16_t show_us)
+{
+    for (DataReader &reader : readers)
+    {
+        uint32_t since = reader.sinceEdge();
+        if (reader.getBitsRead() == 0)
+        {
+            // any falling edge may have begun a start mark, stay clear of where it can end
+            if (since + show_us >= ir_start_min_us && since < ir_start_max_us)
+                return false;
+        }
+        else if (since < ir_bit_max_us && since + show_us >= reader.bitGap())
+        {
+            // the next bit edge can't come before the 0 window of this frame opens, the show must fit in that gap.
+            // a show longer than the gap waits for the end of the frame
+            return false;
+        }
+    }
+    return true;
 }
 
 _data &_data::getInstance()
@@ -142,42 +552,109 @@ _data &_data::getInstance()
     return data;
 }
 
+// call from setup(): the core's init() runs after the static constructors and sets Timer1 up for PWM
 void _data::init()
 {
+#if IR_TIMER1
+    // Timer1 free running at CK/128 for the edge timestamps, overflow extends it to 16 bit
+    TCCR1 = (1 << CS13);
+    TIMSK |= (1 << TOIE1);
+#endif
 }
 
+/*
+ * The checksum is a CRC-8 (x^8 + x^2 + x + 1, poly 0x07, init 0) over the low 24 bits,
+ * most significant byte first, xored onto bits 24..31. That is bit-exact with the
+ * original eight masked shift-xor terms plus fold, without any 32 bit shifts.
+ * Bits 24..31 don't feed the checksum, so applying it twice gives back the input:
+ * one function both checks (crc field 0 means valid) and seals a packet.
+ */
 uint32_t _data::calculateCRC(uint32_t raw_packet)
 {
-    uint32_t raw = raw_packet;
-    uint32_t checksum = ((raw << 2) & 0b10000000111111110111111100) ^
-                        ((raw << 1) & 0b01111111100000000111111110) ^
-                        ((raw << 0) & 0b00000000111111111111111111) ^
-                        ((raw >> 1) & 0b00000000100000000000000000) ^
-                        ((raw >> 2) & 0b00000000011111110000000000) ^
-                        ((raw >> 3) & 0b00000000111111111000000000) ^
-                        ((raw >> 4) & 0b00000011100000001111111100) ^
-                        ((raw >> 5) & 0b00000000111111111000000010);
-    checksum = checksum ^ (checksum >> 8) ^ (checksum >> 16) ^ (checksum >> 24);
-    checksum = checksum & 0xFF;
-    raw ^= checksum << 24;
-    return raw;
+    uint8_t b2 = raw_packet >> 16;
+    uint8_t b1 = raw_packet >> 8;
+    uint8_t b0 = raw_packet;
+#if IR_CRC_BYTE_TABLE
+    uint8_t crc = pgm_read_byte(&crc8_table[b2]);
+    crc = pgm_read_byte(&crc8_table[crc ^ b1]);
+    crc = pgm_read_byte(&crc8_table[crc ^ b0]);
+#else
+    uint8_t crc = crc8_nibble(0, b2);
+    crc = crc8_nibble(crc, b1);
+    crc = crc8_nibble(crc, b0);
+#endif
+    return raw_packet ^ ((uint32_t)crc << 24);
+}
+
+IrDataPacket _data::encodePacket(IrDataPacket packet)
+{
+    packet.set_crc(0);
+    packet.set_unused(0);
+    return IrDataPacket(calculateCRC(packet.get_raw()));
 }
 
-void _data::receive_ISR(bool ir1)
+// compile time unrolled over the receivers: only the ones whose pin changed run
+template <>
+inline void _data::dispatch<IR_RECEIVERS>(uint8_t, uint8_t, ir_time_t) {}
+
+template <uint8_t I>
+inline void _data::dispatch(uint8_t pins, uint8_t changed, ir_time_t time)
+{
+    const uint8_t bit = 1 << ir_receiver_pins[I];
+    if ((changed & bit) && readers[I].handlePinChange(pins & bit, time))
+        deliver(readers[I], time);
+    dispatch<I + 1>(pins, changed, time);
+}
+
+// a frame completed, once per 32 bits so the extra work here doesn't matter
+void _data::deliver(DataReader &reader, ir_time_t time)
+{
+    uint32_t frame = reader.lastFrame();
+    if (IR_RECEIVERS > 1 && frame == lastFrame && (ir_time_t)(time - lastFrameTime) < IR_TICKS(IR_DEDUP_US))
+    {
+        // another receiver just had the same shot
+        count_saturating(duplicates);
+    }
+    else
+    {
+        reader.push();
+    }
+    lastFrame = frame;
+    lastFrameTime = time;
+}
+
+void _data::receive_ISR(uint8_t pins)
 {
-    ir1_reader.handlePinChange(ir1);
+    uint8_t changed = (pins ^ pinState) & ir_receiver_mask();
+    pinState = pins;
+    if (changed)
+    {
+        dispatch<0>(pins, changed, irNow());
+        pinChanges++;
+    }
+}
+
+void _data::timer1Overflow_ISR()
+{
+#if IR_TIMER1
+    timer1High++;
+#endif
 }
 
 /* #endregion */
 
 _data &Data = Data.getInstance();
 
-// this is the attiny85 interrupt vector for external pin change (configured for PCINT4)
+// this is the attiny85 interrupt vector for external pin change (configured for the receiver pins)
 ISR(PCINT0_vect)
 {
-    // check the status of the pin and pass it to the receive_ISR
-    // bool IR1 = PINB & (1 << PB4);
-    bool IR1 = (PINB & 0b00010000);
+    // read the port once, receive_ISR works out which receivers changed
+    Data.receive_ISR(PINB);
+}
 
-    Data.receive_ISR(IR1);
+#if IR_TIMER1
+ISR(TIMER1_OVF_vect)
+{
+    Data.timer1Overflow_ISR();
 }
+#endif
@@ -2,6 +2,7 @@
 #ifndef DATA_H
 #define DATA_H
 #include <Arduino.h>
+#include "spsc_ring.h"
 
 const int ir_bit_lenght = 32;
 const int ir_start_high_time = 16;
@@ -13,8 +14,109 @@ const int ir_one_low_time = 3;
 const int ir_stop_high_time = 1;
 const int ir_stop_low_time = 1;
 const int pulse_train_lenght =  2 + ir_bit_lenght * 2 + 2;
+
+/* bit timing
+ * IR_ADAPTIVE 0: fixed windows, 13500, 1120 and 2250 us +-20 %
+ * IR_ADAPTIVE 1: the start pulse is taken from 70 % to 143 % of 13500 us and the bit windows of that frame
+ *                are centred on the 1120 and 2250 us it scales to (RC oscillators on both ends):
+ *                62.5 % of the 0 up to halfway to the 1, from there to 125 % of the 1.
+ *                a mark shorter than IR_GLITCH_US and a falling edge
+ *                too soon after the last bit (a dropout in the mark) are dropped before the decoder sees them,
+ *                the bits are then taken on the rising edge, timed by the falling one.
+ *                _data::setAdaptive(false) switches back to the fixed windows at runtime, to compare.
+ */
+#ifndef IR_ADAPTIVE
+#define IR_ADAPTIVE 1
+#endif
+#define IR_GLITCH_US 160 // the marks are 560 us
+#if IR_ADAPTIVE
+#define IR_START_TOLERANCE 0.7
+#define IR_ZERO_MIN 0.625 // of the bit times learned from the start pulse
+#define IR_ONE_MAX 1.25
+#else
+#define IR_START_TOLERANCE 0.8
+#define IR_ZERO_MIN 0.8
+#define IR_ONE_MAX 1.25
+#endif
+const uint16_t ir_bit_min_us = (uint16_t)(1120 * IR_START_TOLERANCE * IR_ZERO_MIN); // earliest the next bit edge can follow a bit edge, any frame
+const uint16_t ir_bit_max_us = (uint16_t)(2250 / IR_START_TOLERANCE * IR_ONE_MAX); // latest, after that the frame is lost
+const uint16_t ir_start_min_us = (uint16_t)(13500 * IR_START_TOLERANCE);
+const uint16_t ir_start_max_us = (uint16_t)(13500 / IR_START_TOLERANCE);
+
+/* edge timestamps
+ * IR_TIMER1 1: free running Timer1 at CK/128, 16 us ticks extended to 16 bit by its overflow interrupt.
+ *              the ISR only reads two bytes and the bit windows are 8 bit compares.
+ *              takes Timer1 (no PWM on PB1/PB4).
+ * IR_TIMER1 0: micros(), 32 bit arithmetic in the ISR
+ */
+#ifndef IR_TIMER1
+#define IR_TIMER1 1
+#endif
+#if IR_TIMER1
+#define IR_TICK_US 16 // F_CPU / 128 at 8 MHz
+typedef uint16_t ir_time_t;
+#else
+#define IR_TICK_US 1
+typedef uint32_t ir_time_t;
+#endif
+#define IR_TICKS(us) ((ir_time_t)((us) / IR_TICK_US))
+#if IR_TIMER1
+typedef uint8_t ir_bit_time_t; // bit times fit a byte of ticks
+#else
+typedef uint32_t ir_bit_time_t;
+#endif
+
+// bit windows in ticks, exclusive bounds
+struct IrWindows
+{
+  ir_bit_time_t zeroMin, zeroMax, oneMin, oneMax;
+};
+
+#ifndef IR_CRC_BYTE_TABLE
+#define IR_CRC_BYTE_TABLE 0 // 1: 256 byte crc table (3 lookups), 0: 16 byte nibble table (6 lookups)
+#endif
+
 #define IR_IN1_PIN 4 // PB4
 
+/* receivers, one DataReader each: comma separated PBx pins, e.g. -DIR_RECEIVER_PINS=4,1
+ * free on the hat: PB1, PB4, and PB0/PB2 if I2C isn't used (PB3 drives the leds)
+ */
+#ifndef IR_RECEIVER_PINS
+#define IR_RECEIVER_PINS IR_IN1_PIN
+#endif
+constexpr uint8_t ir_receiver_pins[] = {IR_RECEIVER_PINS};
+#define IR_RECEIVERS ((uint8_t)sizeof(ir_receiver_pins))
+constexpr uint8_t ir_receiver_mask(uint8_t i = 0)
+{
+  return i == IR_RECEIVERS ? 0 : (uint8_t)(1 << ir_receiver_pins[i]) | ir_receiver_mask(i + 1);
+}
+static_assert((ir_receiver_mask() & ~0b00010111) == 0, "ir receivers can only use PB0, PB1, PB2 and PB4");
+#define IR_DEDUP_US 20000 // the same frame completing on two receivers within this is one shot
+#define IR_QUEUE_SIZE 4 // decoded frames buffered between the ISR and loop(), power of two
+
+/* decoder telemetry, for when shots don't register
+ * IR_TELEMETRY 1: 8 bit counters that saturate, the ISR bumps at most one per edge,
+ *   15 bytes of ram plus 7 per receiver, off unless asked for
+ * IR_HISTOGRAM 1: adds a capture mode, the falling edge to falling edge times go into a histogram
+ */
+#ifndef IR_TELEMETRY
+#define IR_TELEMETRY 0
+#endif
+#ifndef IR_HISTOGRAM
+#define IR_HISTOGRAM 0
+#endif
+#define IR_HISTOGRAM_BIN_US 128 // a power of two of ticks, so the bin is a shift
+#define IR_HISTOGRAM_BINS 32    // 0 .. 4096 us, plus one bin for everything longer (start pulses, gaps)
+
+enum IrReject : uint8_t
+{
+  eRejectShort,   // shorter than a 0
+  eRejectBetween, // between the 0 and the 1 window
+  eRejectLong,    // longer than a 1, but not a start pulse
+  eRejectGlitch,  // IR_ADAPTIVE: a mark too short or a dropout in one, dropped before the decoder
+  eRejectReasons
+};
+
 enum TeamColor : uint8_t
 {
   eNoTeam = 0b000,
@@ -34,6 +136,35 @@ enum Action : uint8_t
   eActionHeal = 2,
 };
 
+/**
+ * @brief one bit field of the 32 bit packet, offset and width fixed at compile time
+ * get() cuts the byte (or the two bytes) holding the field out of the packet first,
+ * shifting by whole bytes is free on the avr, and does the rest in 8/16 bit.
+ */
+template <typename T, uint8_t OFFSET, uint8_t WIDTH>
+struct IrField
+{
+  static_assert(WIDTH > 0 && OFFSET + WIDTH <= 32, "field outside the packet");
+  static_assert(WIDTH <= 8 * sizeof(T), "field wider than its type");
+  static_assert(OFFSET % 8 + WIDTH <= 16, "field spans more than two bytes");
+
+  static const uint8_t offset = OFFSET;
+  static const uint8_t width = WIDTH;
+  static const uint8_t next = OFFSET + WIDTH;
+
+  static inline T get(uint32_t raw)
+  {
+    return (OFFSET % 8 + WIDTH <= 8)
+               ? (T)(((uint8_t)(raw >> (OFFSET / 8 * 8)) >> (OFFSET % 8)) & (uint8_t)((1U << WIDTH) - 1))
+               : (T)(((uint16_t)(raw >> (OFFSET / 8 * 8)) >> (OFFSET % 8)) & (uint16_t)((1UL << WIDTH) - 1));
+  }
+  static inline uint32_t set(uint32_t raw, T value)
+  {
+    const uint32_t mask = ((1UL << WIDTH) - 1) << OFFSET;
+    return (raw & ~mask) | (((uint32_t)value << OFFSET) & mask);
+  }
+};
+
 /**
  * @brief IR data packet
  * holds the 32 ir bits in a private uint32_t
@@ -50,60 +181,168 @@ class IrDataPacket
 {
 private:
   uint32_t raw;
+
 public:
-  IrDataPacket();
-  IrDataPacket(uint32_t raw);
-  uint32_t get_raw();
-  void set_raw(uint32_t raw);
-  uint8_t get_channel();
-  void set_channel(uint8_t channel);
-  uint8_t get_team();
-  void set_team(uint8_t team);
-  uint8_t get_action();
-  void set_action(uint8_t action);
-  uint8_t get_action_param();
-  void set_action_param(uint8_t action_param);
-  uint16_t get_player_id();
-  void set_player_id(uint16_t player_id);
-  uint8_t get_crc();
-  void set_crc(uint8_t crc);
-  uint8_t get_unused();
-  void set_unused(uint8_t unused);
+  typedef IrField<uint8_t, 0, 1> Channel;
+  typedef IrField<uint8_t, Channel::next, 3> Team;
+  typedef IrField<uint8_t, Team::next, 2> Action;
+  typedef IrField<uint8_t, Action::next, 4> ActionParam;
+  typedef IrField<uint16_t, ActionParam::next, 12> PlayerId;
+  typedef IrField<uint8_t, PlayerId::next, 8> Crc;
+  typedef IrField<uint8_t, Crc::next, 2> Unused;
+
+  IrDataPacket() {}
+  IrDataPacket(uint32_t raw) : raw(raw) {}
+  uint32_t get_raw() const { return raw; }
+  void set_raw(uint32_t raw) { this->raw = raw; }
+  uint8_t get_channel() const { return Channel::get(raw); }
+  void set_channel(uint8_t channel) { raw = Channel::set(raw, channel); }
+  uint8_t get_team() const { return Team::get(raw); }
+  void set_team(uint8_t team) { raw = Team::set(raw, team); }
+  uint8_t get_action() const { return Action::get(raw); }
+  void set_action(uint8_t action) { raw = Action::set(raw, action); }
+  uint8_t get_action_param() const { return ActionParam::get(raw); }
+  void set_action_param(uint8_t action_param) { raw = ActionParam::set(raw, action_param); }
+  uint16_t get_player_id() const { return PlayerId::get(raw); }
+  void set_player_id(uint16_t player_id) { raw = PlayerId::set(raw, player_id); }
+  uint8_t get_crc() const { return Crc::get(raw); }
+  void set_crc(uint8_t crc) { raw = Crc::set(raw, crc); }
+  uint8_t get_unused() const { return Unused::get(raw); }
+  void set_unused(uint8_t unused) { raw = Unused::set(raw, unused); }
 };
 
+// the layout documented above, as the blasters send it
+static_assert(IrDataPacket::Channel::offset == 0 && IrDataPacket::Channel::width == 1, "channel: bit 0");
+static_assert(IrDataPacket::Team::offset == 1 && IrDataPacket::Team::width == 3, "team: bits 1..3");
+static_assert(IrDataPacket::Action::offset == 4 && IrDataPacket::Action::width == 2, "action: bits 4..5");
+static_assert(IrDataPacket::ActionParam::offset == 6 && IrDataPacket::ActionParam::width == 4, "action_param: bits 6..9");
+static_assert(IrDataPacket::PlayerId::offset == 10 && IrDataPacket::PlayerId::width == 12, "player_id: bits 10..21");
+static_assert(IrDataPacket::Crc::offset == 22 && IrDataPacket::Crc::width == 8, "crc: bits 22..29");
+static_assert(IrDataPacket::Unused::offset == 30 && IrDataPacket::Unused::next == 32, "unused: bits 30..31");
+
+// counters since the last takeTelemetry(), saturate at 255
+struct IrTelemetry
+{
+  uint8_t framesStarted;            // start pulses
+  uint8_t framesCompleted;          // all 32 bits in
+  uint8_t idleEdges;                // falling edges outside a frame that weren't a start pulse
+  uint8_t rejected[eRejectReasons]; // edges inside a frame outside both bit windows, the bit is skipped
+  uint8_t overruns;                 // frames dropped on a full queue
+  uint8_t duplicates;               // frames another receiver had already
+  uint8_t crcFailures;              // frames readIr dropped
+  uint8_t teams[8];                 // valid packets by TeamColor
+  uint8_t actions[4];               // valid packets by Action
+};
+
+struct IrHistogram
+{
+  uint16_t bins[IR_HISTOGRAM_BINS + 1]; // bin i counts i * IR_HISTOGRAM_BIN_US up to the next one, saturate
+};
 
+/**
+ * @brief decodes one ir receiver
+ * handlePinChange runs in the ISR and is the only producer, loop() is the only consumer.
+ * decoded frames go into an SpscRing of IR_QUEUE_SIZE entries, no interrupts need to be masked.
+ */
 class DataReader
 {
 private:
-  volatile uint32_t refTime;
-  volatile bool oldState = 1;
-  volatile uint32_t rawData;
+  volatile ir_time_t refTime; // last falling edge
+  uint32_t rawData; // frame being shifted in, only touched by the ISR
   volatile uint8_t bitsRead;
-  volatile bool dataReady;
+  volatile bool stale; // no falling edge for ir_start_max_us, set by sinceEdge, cleared by the ISR
+  SpscRing<uint32_t, IR_QUEUE_SIZE> queue; // the ISR pushes, loop() pops
+  volatile uint8_t overflows; // frames dropped on a full queue, saturates at 255
+#if IR_TELEMETRY
+  uint8_t started, completed, idle, rejected[eRejectReasons]; // ISR only, read under cli()
+#endif
+#if IR_ADAPTIVE
+  IrWindows windows;   // of the frame coming in, from its start pulse
+  ir_time_t markAt;    // falling edge of the mark, decoded on its rising edge
+  bool markPending;
+
+  void learnWindows(ir_time_t start);
+#endif
+
+  bool fallingEdge(ir_time_t time);
 
 public:
-  void handlePinChange(bool state);
+  bool handlePinChange(bool state, ir_time_t time); // ISR, only called on a change of this pin: true when a frame is complete
+  uint32_t lastFrame();                              // ISR: the frame just completed
+  void push();                                       // ISR: queue it
   void reset();           // clear buffer
-  bool isDataReady();     // check buffer, if valid True, if invalid ResetBuffer
-  uint32_t getPacket(); // return packet and reset; Dataclass then needs to calculate CRC
+  bool isDataReady();     // check buffer, True if a frame is queued
+  uint32_t getPacket();   // pop the oldest frame; Dataclass then needs to calculate CRC
+  uint8_t getOverflowCount();
+  uint32_t sinceEdge();              // time since the last falling edge [us], ir_start_max_us once it is older
+  uint32_t bitGap();                 // earliest the next bit edge can follow the last one [us], by the windows of the frame
+  uint8_t getBitsRead();             // 0 while waiting for a start pulse
+#if IR_TELEMETRY
+  void takeCounters(IrTelemetry &telemetry); // add its counters and clear them, call under cli()
+#endif
+#if IR_ADAPTIVE
+  static bool adaptive; // shared by all receivers, _data::setAdaptive
+  void fixWindows();    // back to the fixed windows
+#endif
 };
 
 class _data
 {
 private:
   _data();
-  DataReader ir1_reader;
+  DataReader readers[IR_RECEIVERS];
+  uint8_t pinState;        // PINB at the last pin change interrupt
+  uint32_t lastFrame;      // last frame completed on any receiver, for de-duplication
+  ir_time_t lastFrameTime;
+  uint16_t received;
+  uint8_t duplicates;
+  volatile uint8_t pinChanges; // receiver pin change interrupts, wraps
+#if IR_TELEMETRY
+  uint8_t overflowMark, duplicateMark; // getOverflowCount/getDuplicateCount at the last takeTelemetry
+  uint8_t crcFailures;
+  uint8_t teams[8];
+  uint8_t actions[4];
+#endif
 
   void enableReceive();
   void disableReceive();
+  template <uint8_t I>
+  void dispatch(uint8_t pins, uint8_t changed, ir_time_t time);
+  void deliver(DataReader &reader, ir_time_t time);
 
 public:
-  IrDataPacket readIr();
+  IrDataPacket readIr();                                        // oldest valid packet, IrDataPacket(0) if none
+  uint8_t readIr(IrDataPacket *packets, uint8_t max_packets); // drain up to max_packets valid packets, returns count
+  template <uint8_t N>
+  uint8_t readIr(IrDataPacket (&packets)[N]) { return readIr(packets, N); }
+  void flushIr();                                               // drop everything queued
+  uint8_t getOverflowCount();                                   // frames lost because loop() didn't drain in time
+  uint16_t getReceivedCount();                                  // valid packets handed out by readIr
+  uint8_t getDuplicateCount();                                  // frames dropped because another receiver had them
+  uint8_t getPinChangeCount();                                  // wraps, a change means an edge came in (wake accounting)
+#if IR_TELEMETRY
+  void takeTelemetry(IrTelemetry &telemetry);                   // the counters since the last call, then they start over
+#endif
+#if IR_ADAPTIVE
+  void setAdaptive(bool adaptive);                              // false: fixed windows like IR_ADAPTIVE 0, for comparison
+#endif
+#if IR_HISTOGRAM
+  void startCapture();                                          // clear the histogram, every edge from now on goes in
+  void stopCapture();
+  void readHistogram(IrHistogram &histogram);                   // a copy, also while capturing
+#endif
+
+  // coordination with the led output, which blocks interrupts while it runs
+  bool frameInProgress();                                       // a frame is on the air right now
+  uint32_t remainingAirtime();                                  // worst case [us] until it is complete, 0 if idle
+  bool canShow(uint16_t show_us);                               // a show() of show_us fits before the next edge of the frame
 
   static _data &getInstance();
-  uint32_t calculateCRC(uint32_t raw_packet);
-  void receive_ISR(bool ir1); // function called by ISR
-  void init();
+  uint32_t calculateCRC(uint32_t raw_packet);          // xor the checksum into the crc bits: 0 there means valid
+  IrDataPacket encodePacket(IrDataPacket packet);      // fill in crc (and unused) so readIr accepts the packet
+  void receive_ISR(uint8_t pins); // function called by ISR with PINB
+  void timer1Overflow_ISR();      // IR_TIMER1: extends Timer1 to 16 bit
+  void init();                    // Timer1 for the edge timestamps, call from setup()
 };
 
 extern _data &Data;
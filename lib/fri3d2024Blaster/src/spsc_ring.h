@@ -0,0 +1,47 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+#include <stdint.h>
+
+/**
+ * @brief a single-producer/single-consumer ring of N entries between an ISR and loop()
+ * head and tail are free running 8 bit counters: each side only writes its own one,
+ * and an 8 bit store is atomic on the avr, so no interrupts need to be masked.
+ * head - tail is the number queued, 0..N, so all N slots are used.
+ * the producer fills back() and publishes it with push(), the consumer reads front()
+ * and hands the slot back with pop(): each only once it is done with the slot.
+ */
+template <typename T, uint8_t N>
+class SpscRing
+{
+  static_assert(N != 0 && (N & (N - 1)) == 0, "the ring size must be a power of two");
+
+private:
+  volatile T slots[N];
+  volatile uint8_t head; // next slot to fill, producer only
+  volatile uint8_t tail; // next slot to read, consumer only
+
+public:
+  void clear() { head = tail = 0; } // before either side runs
+  uint8_t size() const { return head - tail; }
+  bool empty() const { return head == tail; }
+  bool full() const { return (uint8_t)(head - tail) >= N; }
+
+  // producer, not full()
+  volatile T &back() { return slots[head & (N - 1)]; }
+  void push() { head = head + 1; }
+
+  // consumer, not empty()
+  const volatile T &front() const { return slots[tail & (N - 1)]; }
+  void pop() { tail = tail + 1; }
+  void drop() { tail = head; } // everything queued
+};
+
+// a counter that stops at its top instead of wrapping around
+template <typename T>
+inline void count_saturating(T &counter)
+{
+  if (counter != (T)~(T)0)
+    counter++;
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+/**
+ * @brief host stand-in for the Arduino core ([env:native] only)
+ * just enough of Arduino.h and the attiny85 io registers to compile
+ * src/main.cpp and lib/fri3d2024Blaster on Linux.
+ * time is a virtual clock, see native_hal.h
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define F_CPU 8000000UL
+
+// program memory is plain memory on the host
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define memcpy_P memcpy
+
+// attiny85 io registers, plain variables on the host
+extern volatile uint8_t PINB;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t GIMSK;
+extern volatile uint8_t PCMSK;
+extern volatile uint8_t GIFR;
+extern volatile uint8_t SREG;
+extern volatile uint8_t TCCR1;
+extern volatile uint8_t TIMSK;
+extern volatile uint8_t TIFR;
+extern volatile uint8_t OCR1A;
+extern volatile uint8_t MCUCR;
+extern volatile uint8_t CLKPR; // CLKPS divides the clock of the cpu and Timer1, see native_hal.cpp
+extern volatile uint8_t TCCR0B;
+// Timer1 counts along with the virtual clock, see native_hal.cpp
+uint8_t native_hal_tcnt1();
+#define TCNT1 (native_hal_tcnt1())
+// the eeprom: a write set off through EECR takes its programming time of the virtual clock,
+// then EE_RDY_vect fires for as long as EERIE is set. reading EECR while a write runs
+// moves the clock to its end, what polling EEPE would take, see native_hal.cpp
+extern volatile uint16_t EEAR;
+extern volatile uint8_t EEDR;
+uint8_t native_hal_eecr();
+struct NativeEecr
+{
+  uint8_t value;
+  operator uint8_t() const { return native_hal_eecr(); }
+  NativeEecr &operator=(uint8_t v);
+  NativeEecr &operator|=(uint8_t v) { return *this = value | v; }
+  NativeEecr &operator&=(uint8_t v) { return *this = value & v; }
+};
+extern NativeEecr EECR;
+#define E2END 0x1FF
+// the USI in two wire mode, nativeHal::i2cStart() and friends play the controller
+extern volatile uint8_t USICR;
+extern volatile uint8_t USISR; // the flags are not kept, only the counter
+extern volatile uint8_t USIDR;
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+#define PCIE 5
+#define PCIF 5
+#define SREG_I 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define CS13 3
+#define TOIE1 2
+#define TOV1 2
+#define OCIE1A 6
+#define OCF1A 6
+#define SM0 3
+#define SM1 4
+#define SE 5
+#define CLKPCE 7
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define EEPM0 4
+#define EEPM1 5
+#define USISIE 7
+#define USIOIE 6
+#define USIWM1 5
+#define USIWM0 4
+#define USICS1 3
+#define USICS0 2
+#define USICLK 1
+#define USITC 0
+#define USISIF 7
+#define USIOIF 6
+#define USIPF 5
+#define USIDC 4
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+
+// interrupt vectors become plain functions the host can call
+#define ISR(vector, ...) extern "C" void vector(void)
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= (uint8_t)~_BV(SREG_I))
+#define interrupts() sei()
+#define noInterrupts() cli()
+
+// avr/sleep.h, sleep_cpu() hands the virtual clock to the harness until the next interrupt
+#define SLEEP_MODE_IDLE 0
+#define set_sleep_mode(mode) (MCUCR = (MCUCR & (uint8_t)~(_BV(SM0) | _BV(SM1))) | (mode))
+#define sleep_enable() (MCUCR |= _BV(SE))
+#define sleep_disable() (MCUCR &= (uint8_t)~_BV(SE))
+void native_hal_sleep();
+#define sleep_cpu() native_hal_sleep()
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+void setup();
+void loop();
+
+#endif
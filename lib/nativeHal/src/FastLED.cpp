@@ -0,0 +1,279 @@
+#include <FastLED.h>
+
+uint16_t rand16seed = 1337;
+CFastLED FastLED;
+
+void native_hal_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness); // native_hal.cpp
+
+/* #region color math */
+// hsv2rgb_rainbow, as in FastLED hsv2rgb.cpp (Y1 = 1, no green dimming)
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+    uint8_t hue = hsv.hue;
+    uint8_t sat = hsv.sat;
+    uint8_t val = hsv.val;
+
+    uint8_t offset8 = (hue & 0x1F) << 3;
+    uint8_t third = scale8(offset8, (256 / 3));
+    uint8_t r, g, b;
+
+    if (!(hue & 0x80))
+    {
+        if (!(hue & 0x40))
+        {
+            if (!(hue & 0x20))
+            { // R -> O
+                r = 255 - third;
+                g = third;
+                b = 0;
+            }
+            else
+            { // O -> Y
+                r = 171;
+                g = 85 + third;
+                b = 0;
+            }
+        }
+        else
+        {
+            if (!(hue & 0x20))
+            { // Y -> G
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                r = 171 - twothirds;
+                g = 170 + third;
+                b = 0;
+            }
+            else
+            { // G -> A
+                r = 0;
+                g = 255 - third;
+                b = third;
+            }
+        }
+    }
+    else
+    {
+        if (!(hue & 0x40))
+        {
+            if (!(hue & 0x20))
+            { // A -> B
+                uint8_t twothirds = scale8(offset8, ((256 * 2) / 3));
+                r = 0;
+                g = 171 - twothirds;
+                b = 85 + twothirds;
+            }
+            else
+            { // B -> P
+                r = third;
+                g = 0;
+                b = 255 - third;
+            }
+        }
+        else
+        {
+            if (!(hue & 0x20))
+            { // P -> K
+                r = 85 + third;
+                g = 0;
+                b = 171 - third;
+            }
+            else
+            { // K -> R
+                r = 170 + third;
+                g = 0;
+                b = 85 - third;
+            }
+        }
+    }
+
+    if (sat != 255)
+    {
+        if (sat == 0)
+        {
+            r = 255;
+            g = 255;
+            b = 255;
+        }
+        else
+        {
+            uint8_t desat = 255 - sat;
+            desat = scale8_video(desat, desat);
+            uint8_t satscale = 255 - desat;
+            if (r)
+                r = scale8(r, satscale) + 1;
+            if (g)
+                g = scale8(g, satscale) + 1;
+            if (b)
+                b = scale8(b, satscale) + 1;
+            r += desat;
+            g += desat;
+            b += desat;
+        }
+    }
+
+    if (val != 255)
+    {
+        val = scale8_video(val, val);
+        if (val == 0)
+        {
+            r = 0;
+            g = 0;
+            b = 0;
+        }
+        else
+        {
+            if (r)
+                r = scale8(r, val) + 1;
+            if (g)
+                g = scale8(g, val) + 1;
+            if (b)
+                b = scale8(b, val) + 1;
+        }
+    }
+
+    rgb.r = r;
+    rgb.g = g;
+    rgb.b = b;
+}
+
+// not FastLED's exact approximation, close enough for the host
+CHSV rgb2hsv_approximate(const CRGB &rgb)
+{
+    uint8_t hi = rgb.r > rgb.g ? (rgb.r > rgb.b ? rgb.r : rgb.b) : (rgb.g > rgb.b ? rgb.g : rgb.b);
+    uint8_t lo = rgb.r < rgb.g ? (rgb.r < rgb.b ? rgb.r : rgb.b) : (rgb.g < rgb.b ? rgb.g : rgb.b);
+    uint8_t delta = hi - lo;
+    if (hi == 0)
+        return CHSV(0, 0, 0);
+    if (delta == 0)
+        return CHSV(0, 0, hi);
+
+    int hue;
+    if (hi == rgb.r)
+        hue = 43 * (rgb.g - rgb.b) / delta;
+    else if (hi == rgb.g)
+        hue = 85 + 43 * (rgb.b - rgb.r) / delta;
+    else
+        hue = 171 + 43 * (rgb.r - rgb.g) / delta;
+    return CHSV((uint8_t)hue, (uint16_t)delta * 255 / hi, hi);
+}
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay)
+{
+    if (amountOfOverlay == 0)
+        return existing;
+    if (amountOfOverlay == 255)
+    {
+        existing = overlay;
+        return existing;
+    }
+    fract8 amountOfKeep = 255 - amountOfOverlay;
+    existing.r = scale8(existing.r, amountOfKeep) + scale8(overlay.r, amountOfOverlay);
+    existing.g = scale8(existing.g, amountOfKeep) + scale8(overlay.g, amountOfOverlay);
+    existing.b = scale8(existing.b, amountOfKeep) + scale8(overlay.b, amountOfOverlay);
+    return existing;
+}
+
+CRGB blend(const CRGB &p1, const CRGB &p2, fract8 amountOfP2)
+{
+    CRGB nu(p1);
+    nblend(nu, p2, amountOfP2);
+    return nu;
+}
+/* #endregion */
+
+/* #region palettes */
+const TProgmemRGBPalette16 RainbowColors_p PROGMEM = {
+    0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00, 0xABAB00, 0x56D500, 0x00FF00, 0x00D52A,
+    0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5, 0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B};
+
+const TProgmemRGBPalette16 PartyColors_p PROGMEM = {
+    0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700, 0xAB7700, 0xABAB00,
+    0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E, 0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9};
+
+const TProgmemRGBPalette16 OceanColors_p PROGMEM = {
+    CRGB::MidnightBlue, CRGB::DarkBlue, CRGB::MidnightBlue, CRGB::Navy,
+    CRGB::DarkBlue, CRGB::MediumBlue, CRGB::SeaGreen, CRGB::Teal,
+    CRGB::CadetBlue, CRGB::Blue, CRGB::DarkCyan, CRGB::CornflowerBlue,
+    CRGB::Aquamarine, CRGB::SeaGreen, CRGB::Aqua, CRGB::LightSkyBlue};
+
+const TProgmemRGBPalette16 ForestColors_p PROGMEM = {
+    CRGB::DarkGreen, CRGB::DarkGreen, CRGB::DarkOliveGreen, CRGB::DarkGreen,
+    CRGB::Green, CRGB::ForestGreen, CRGB::OliveDrab, CRGB::Green,
+    CRGB::SeaGreen, CRGB::MediumAquamarine, CRGB::LimeGreen, CRGB::YellowGreen,
+    CRGB::LightGreen, CRGB::LawnGreen, CRGB::MediumAquamarine, CRGB::ForestGreen};
+
+// ColorFromPalette as in FastLED colorutils.cpp, the two entries around index come from the caller
+static CRGB palette_sample(CRGB entry, CRGB next, uint8_t index, uint8_t brightness, TBlendType blendType)
+{
+    uint8_t lo4 = index & 0x0F;
+    uint8_t red1 = entry.red;
+    uint8_t green1 = entry.green;
+    uint8_t blue1 = entry.blue;
+
+    if (lo4 && blendType != NOBLEND)
+    {
+        uint8_t f2 = lo4 << 4;
+        uint8_t f1 = 255 - f2;
+        red1 = scale8(red1, f1) + scale8(next.red, f2);
+        green1 = scale8(green1, f1) + scale8(next.green, f2);
+        blue1 = scale8(blue1, f1) + scale8(next.blue, f2);
+    }
+
+    if (brightness != 255)
+    {
+        if (brightness)
+        {
+            ++brightness;
+            if (red1)
+                red1 = scale8(red1, brightness) + 1;
+            if (green1)
+                green1 = scale8(green1, brightness) + 1;
+            if (blue1)
+                blue1 = scale8(blue1, brightness) + 1;
+        }
+        else
+        {
+            red1 = 0;
+            green1 = 0;
+            blue1 = 0;
+        }
+    }
+
+    return CRGB(red1, green1, blue1);
+}
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness, TBlendType blendType)
+{
+    uint8_t hi4 = index >> 4;
+    return palette_sample(pal[hi4], pal[(hi4 + 1) & 0x0F], index, brightness, blendType);
+}
+
+// straight from flash, no CRGBPalette16 copy
+CRGB ColorFromPalette(const TProgmemRGBPalette16 &pal, uint8_t index, uint8_t brightness, TBlendType blendType)
+{
+    uint8_t hi4 = index >> 4;
+    return palette_sample(CRGB(pgm_read_dword(&pal[hi4])), CRGB(pgm_read_dword(&pal[(hi4 + 1) & 0x0F])), index, brightness,
+                          blendType);
+}
+/* #endregion */
+
+/* #region controller */
+void CFastLED::show()
+{
+    native_hal_show(leds, num_leds, brightness);
+}
+
+void CFastLED::clear(bool writeData)
+{
+    for (uint16_t i = 0; i < num_leds; i++)
+        leds[i] = CRGB(0, 0, 0);
+    if (writeData)
+        show();
+}
+
+void CFastLED::delay(unsigned long ms)
+{
+    show();
+    ::delay(ms);
+}
+/* #endregion */
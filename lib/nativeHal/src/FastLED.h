@@ -0,0 +1,386 @@
+#ifndef NATIVE_FASTLED_H
+#define NATIVE_FASTLED_H
+/**
+ * @brief host stand-in for FastLED ([env:native] only)
+ * covers the subset the hat uses: CRGB/CHSV, CRGBArray/CRGBSet views,
+ * lib8tion math, 16 entry palettes, EVERY_N_* timers and the FastLED controller.
+ * math follows FastLED 3.7 (FASTLED_SCALE8_FIXED) so frames match the attiny85.
+ */
+#include <Arduino.h>
+
+typedef uint8_t fract8;
+
+/* #region lib8tion */
+static inline uint8_t scale8(uint8_t i, fract8 scale) { return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8; }
+static inline uint8_t scale8_video(uint8_t i, fract8 scale) { return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0); }
+static inline uint8_t qadd8(uint8_t i, uint8_t j)
+{
+    unsigned int t = i + j;
+    return t > 255 ? 255 : t;
+}
+static inline uint8_t qsub8(uint8_t i, uint8_t j) { return i > j ? i - j : 0; }
+static inline uint8_t dim8_video(uint8_t x) { return scale8_video(x, x); }
+static inline uint8_t brighten8_video(uint8_t x)
+{
+    uint8_t ix = 255 - x;
+    return 255 - scale8_video(ix, ix);
+}
+static inline uint8_t lerp8by8(uint8_t a, uint8_t b, fract8 frac)
+{
+    return b > a ? a + scale8(b - a, frac) : a - scale8(a - b, frac);
+}
+static inline void nscale8x3(uint8_t &r, uint8_t &g, uint8_t &b, fract8 scale)
+{
+    uint16_t s = scale + 1;
+    r = (r * s) >> 8;
+    g = (g * s) >> 8;
+    b = (b * s) >> 8;
+}
+
+extern uint16_t rand16seed;
+static inline void random16_set_seed(uint16_t seed) { rand16seed = seed; }
+static inline uint16_t random16()
+{
+    rand16seed = (rand16seed * 2053) + 13849;
+    return rand16seed;
+}
+static inline uint8_t random8()
+{
+    rand16seed = (rand16seed * 2053) + 13849;
+    return (uint8_t)(((uint8_t)(rand16seed & 0xFF)) + ((uint8_t)(rand16seed >> 8)));
+}
+static inline uint8_t random8(uint8_t lim) { return (random8() * lim) >> 8; }
+static inline uint8_t random8(uint8_t min, uint8_t lim) { return random8(lim - min) + min; }
+/* #endregion */
+
+/* #region colors */
+typedef enum
+{
+    HUE_RED = 0,
+    HUE_ORANGE = 32,
+    HUE_YELLOW = 64,
+    HUE_GREEN = 96,
+    HUE_AQUA = 128,
+    HUE_BLUE = 160,
+    HUE_PURPLE = 192,
+    HUE_PINK = 224
+} HSVHue;
+
+struct CHSV
+{
+    union
+    {
+        struct
+        {
+            union
+            {
+                uint8_t hue;
+                uint8_t h;
+            };
+            union
+            {
+                uint8_t sat;
+                uint8_t s;
+            };
+            union
+            {
+                uint8_t val;
+                uint8_t v;
+            };
+        };
+        uint8_t raw[3];
+    };
+    CHSV() {}
+    CHSV(uint8_t ih, uint8_t is, uint8_t iv) : hue(ih), sat(is), val(iv) {}
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+CHSV rgb2hsv_approximate(const CRGB &rgb);
+
+struct CRGB
+{
+    union
+    {
+        struct
+        {
+            union
+            {
+                uint8_t r;
+                uint8_t red;
+            };
+            union
+            {
+                uint8_t g;
+                uint8_t green;
+            };
+            union
+            {
+                uint8_t b;
+                uint8_t blue;
+            };
+        };
+        uint8_t raw[3];
+    };
+
+    typedef enum
+    {
+        Aqua = 0x00FFFF,
+        Aquamarine = 0x7FFFD4,
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        CadetBlue = 0x5F9EA0,
+        CornflowerBlue = 0x6495ED,
+        Cyan = 0x00FFFF,
+        DarkBlue = 0x00008B,
+        DarkCyan = 0x008B8B,
+        DarkGreen = 0x006400,
+        DarkOliveGreen = 0x556B2F,
+        ForestGreen = 0x228B22,
+        Green = 0x008000,
+        LawnGreen = 0x7CFC00,
+        LightGreen = 0x90EE90,
+        LightSkyBlue = 0x87CEFA,
+        LimeGreen = 0x32CD32,
+        Magenta = 0xFF00FF,
+        MediumAquamarine = 0x66CDAA,
+        MediumBlue = 0x0000CD,
+        MidnightBlue = 0x191970,
+        Navy = 0x000080,
+        OliveDrab = 0x6B8E23,
+        Red = 0xFF0000,
+        SeaGreen = 0x2E8B57,
+        Teal = 0x008080,
+        White = 0xFFFFFF,
+        Yellow = 0xFFFF00,
+        YellowGreen = 0x9ACD32
+    } HTMLColorCode;
+
+    CRGB() {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+    CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) {}
+    CRGB(HTMLColorCode colorcode) : CRGB((uint32_t)colorcode) {}
+    CRGB(const CHSV &rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+    CRGB &operator=(const CHSV &rhs)
+    {
+        hsv2rgb_rainbow(rhs, *this);
+        return *this;
+    }
+    CRGB &operator=(uint32_t colorcode) { return *this = CRGB(colorcode); }
+
+    uint8_t &operator[](uint8_t x) { return raw[x]; }
+    const uint8_t &operator[](uint8_t x) const { return raw[x]; }
+
+    CRGB &nscale8(uint8_t scaledown)
+    {
+        nscale8x3(r, g, b, scaledown);
+        return *this;
+    }
+    CRGB &fadeToBlackBy(uint8_t fadefactor) { return nscale8(255 - fadefactor); }
+    CRGB &operator+=(const CRGB &rhs)
+    {
+        r = qadd8(r, rhs.r);
+        g = qadd8(g, rhs.g);
+        b = qadd8(b, rhs.b);
+        return *this;
+    }
+    uint8_t getAverageLight() const { return scale8(r, 85) + scale8(g, 85) + scale8(b, 85); }
+    explicit operator bool() const { return r || g || b; }
+    bool operator==(const CRGB &rhs) const { return r == rhs.r && g == rhs.g && b == rhs.b; }
+    bool operator!=(const CRGB &rhs) const { return !(*this == rhs); }
+};
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay);
+CRGB blend(const CRGB &p1, const CRGB &p2, fract8 amountOfP2);
+/* #endregion */
+
+/* #region pixel views */
+template <class PIXEL_TYPE>
+class CPixelView
+{
+public:
+    int8_t dir;
+    int len;
+    PIXEL_TYPE *const leds;
+
+    CPixelView(const CPixelView &other) : dir(other.dir), len(other.len), leds(other.leds) {}
+    CPixelView(PIXEL_TYPE *_leds, int _len) : dir(_len < 0 ? -1 : 1), len(_len), leds(_leds) {}
+    CPixelView(PIXEL_TYPE *_leds, int _start, int _end)
+        : dir(((_end - _start) < 0) ? -1 : 1), len((_end - _start) + dir), leds(_leds + _start) {}
+
+    int size() const { return abs(len); }
+    bool reversed() const { return len < 0; }
+
+    PIXEL_TYPE &operator[](int x) const { return dir < 0 ? leds[-x] : leds[x]; }
+    CPixelView operator()(int start, int end) const
+    {
+        return dir < 0 ? CPixelView(leds, -start, -end) : CPixelView(leds, start, end);
+    }
+    operator PIXEL_TYPE *() const { return leds; }
+
+    CPixelView &operator=(const PIXEL_TYPE &color)
+    {
+        for (int i = 0, n = size(); i < n; i++)
+            (*this)[i] = color;
+        return *this;
+    }
+    CPixelView &operator=(const CHSV &color) { return *this = PIXEL_TYPE(color); }
+    CPixelView &operator=(const CPixelView &rhs)
+    {
+        for (int i = 0, n = size() < rhs.size() ? size() : rhs.size(); i < n; i++)
+            (*this)[i] = rhs[i];
+        return *this;
+    }
+    CPixelView &fill_solid(const PIXEL_TYPE &color) { return *this = color; }
+    CPixelView &nscale8(uint8_t scaledown)
+    {
+        for (int i = 0, n = size(); i < n; i++)
+            (*this)[i].nscale8(scaledown);
+        return *this;
+    }
+    CPixelView &fadeToBlackBy(uint8_t fadeBy) { return nscale8(255 - fadeBy); }
+};
+
+typedef CPixelView<CRGB> CRGBSet;
+
+template <int SIZE, class PIXEL_TYPE = CRGB>
+class CPixelArray : public CPixelView<PIXEL_TYPE>
+{
+    PIXEL_TYPE rawleds[SIZE];
+
+public:
+    CPixelArray() : CPixelView<PIXEL_TYPE>(rawleds, SIZE) {}
+    using CPixelView<PIXEL_TYPE>::operator=;
+};
+
+template <int SIZE>
+using CRGBArray = CPixelArray<SIZE, CRGB>;
+/* #endregion */
+
+/* #region palettes */
+typedef enum
+{
+    NOBLEND = 0,
+    LINEARBLEND = 1
+} TBlendType;
+
+typedef uint32_t TProgmemRGBPalette16[16];
+
+class CRGBPalette16
+{
+public:
+    CRGB entries[16];
+    CRGBPalette16() {}
+    CRGBPalette16(const TProgmemRGBPalette16 &rhs)
+    {
+        for (uint8_t i = 0; i < 16; ++i)
+            entries[i] = CRGB(pgm_read_dword(rhs + i));
+    }
+    CRGB &operator[](uint8_t x) { return entries[x]; }
+    const CRGB &operator[](uint8_t x) const { return entries[x]; }
+};
+
+extern const TProgmemRGBPalette16 RainbowColors_p;
+extern const TProgmemRGBPalette16 PartyColors_p;
+extern const TProgmemRGBPalette16 OceanColors_p;
+extern const TProgmemRGBPalette16 ForestColors_p;
+
+CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+CRGB ColorFromPalette(const TProgmemRGBPalette16 &pal, uint8_t index, uint8_t brightness = 255, TBlendType blendType = LINEARBLEND);
+/* #endregion */
+
+/* #region timers */
+class CEveryNMillis
+{
+public:
+    uint32_t mPrevTrigger;
+    uint32_t mPeriod;
+
+    CEveryNMillis(uint32_t period) : mPeriod(period) { reset(); }
+    uint32_t getTime() { return millis(); }
+    void setPeriod(uint32_t period) { mPeriod = period; }
+    bool ready()
+    {
+        uint32_t now = getTime();
+        bool isReady = (now - mPrevTrigger) >= mPeriod;
+        if (isReady)
+            mPrevTrigger = now;
+        return isReady;
+    }
+    void reset() { mPrevTrigger = getTime(); }
+    operator bool() { return ready(); }
+};
+typedef CEveryNMillis CEveryNMilliseconds;
+
+class CEveryNSeconds : public CEveryNMillis
+{
+public:
+    CEveryNSeconds(uint32_t period) : CEveryNMillis(period * 1000) {}
+};
+
+#define FL_CONCAT_(a, b) a##b
+#define FL_CONCAT(a, b) FL_CONCAT_(a, b)
+#define EVERY_N_MILLISECONDS(N) EVERY_N_MILLIS_I(FL_CONCAT(PER, __COUNTER__), N)
+#define EVERY_N_MILLIS_I(NAME, N) \
+    static CEveryNMillis NAME(N); \
+    if (NAME)
+#define EVERY_N_MILLIS(N) EVERY_N_MILLISECONDS(N)
+#define EVERY_N_SECONDS(N) EVERY_N_SECONDS_I(FL_CONCAT(PER, __COUNTER__), N)
+#define EVERY_N_SECONDS_I(NAME, N) \
+    static CEveryNSeconds NAME(N); \
+    if (NAME)
+/* #endregion */
+
+/* #region controller */
+typedef enum
+{
+    RGB = 0012,
+    GRB = 0102
+} EOrder;
+
+typedef enum
+{
+    TypicalLEDStrip = 0xFFB0F0,
+    UncorrectedColor = 0xFFFFFF
+} LEDColorCorrection;
+
+template <uint8_t DATA_PIN, EOrder RGB_ORDER>
+class WS2812
+{
+};
+
+class CLEDController
+{
+public:
+    CLEDController &setCorrection(LEDColorCorrection) { return *this; }
+};
+
+class CFastLED
+{
+    CLEDController controller;
+    CRGB *leds = nullptr;
+    uint16_t num_leds = 0;
+    uint8_t brightness = 255;
+
+public:
+    template <template <uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+    CLEDController &addLeds(CRGB *data, int nLedsOrOffset)
+    {
+        leds = data;
+        num_leds = nLedsOrOffset;
+        return controller;
+    }
+    void setBrightness(uint8_t scale) { brightness = scale; }
+    uint8_t getBrightness() { return brightness; }
+    void show();
+    void clear(bool writeData = false);
+    void delay(unsigned long ms);
+    CRGB *ledData() { return leds; }
+    uint16_t size() { return num_leds; }
+};
+
+extern CFastLED FastLED;
+/* #endregion */
+
+#endif
@@ -0,0 +1,382 @@
+#include "native_hal.h"
+#include <FastLED.h>
+
+volatile uint8_t PINB = 0xFF;
+volatile uint8_t PORTB;
+volatile uint8_t DDRB;
+volatile uint8_t GIMSK;
+volatile uint8_t PCMSK;
+volatile uint8_t GIFR;
+volatile uint8_t SREG;
+volatile uint8_t TCCR1;
+volatile uint8_t TIMSK;
+volatile uint8_t TIFR;
+volatile uint8_t OCR1A;
+volatile uint8_t MCUCR;
+volatile uint8_t CLKPR;
+volatile uint8_t TCCR0B;
+volatile uint16_t EEAR;
+volatile uint8_t EEDR;
+NativeEecr EECR;
+volatile uint8_t USICR;
+volatile uint8_t USISR;
+volatile uint8_t USIDR;
+
+static uint32_t virtual_us = 0;
+static uint32_t shows = 0;
+static nativeHal::ShowHook show_hook = nullptr;
+static uint16_t show_us = 0;
+static nativeHal::SleepHook sleep_hook = nullptr;
+static uint32_t sleeps = 0;
+
+/* #region Timer1 */
+// Timer1 ticks since virtual time 0, at the clock set in CLKPR and the prescaler set in TCCR1.
+// a switch of either one that doesn't keep the tick rate makes TCNT1 jump, on the avr it wouldn't,
+// but then the decoder's windows would be off anyway
+static uint8_t timer1_shift()
+{
+    return (TCCR1 & 0x0F) - 1 + (CLKPR & 0x0F);
+}
+
+static uint64_t timer1_ticks(uint32_t us)
+{
+    if ((TCCR1 & 0x0F) == 0)
+        return 0;
+    return (uint64_t)us * (F_CPU / 1000000UL) >> timer1_shift();
+}
+
+uint8_t native_hal_tcnt1() { return timer1_ticks(virtual_us); }
+
+// first virtual time Timer1 has counted up to ticks
+static uint32_t timer1_at(uint64_t ticks)
+{
+    const uint32_t per_us = F_CPU / 1000000UL;
+    return (uint32_t)(((ticks << timer1_shift()) + per_us - 1) / per_us);
+}
+
+static void eeprom_until(uint32_t us);
+
+// every clock change goes through here, so Timer1 overflows fire like on the avr
+static void set_clock(uint32_t us)
+{
+    eeprom_until(us);
+    uint64_t overflows = 0;
+    if (us > virtual_us && (TIMSK & _BV(TOIE1)) && TIMER1_OVF_vect)
+        overflows = (timer1_ticks(us) >> 8) - (timer1_ticks(virtual_us) >> 8);
+    uint32_t from = virtual_us;
+    for (uint64_t i = 1; i <= overflows; i++)
+    {
+        // spread the overflows over the step, close to where each wrap happens
+        virtual_us = from + (uint32_t)((us - from) * i / overflows);
+        TIMER1_OVF_vect();
+    }
+    virtual_us = us;
+}
+/* #endregion */
+
+/* #region eeprom */
+#define NATIVE_EEPROM_ATOMIC_US 3400 // erase and write
+#define NATIVE_EEPROM_SPLIT_US 1800  // erase only or write only
+#define NATIVE_EEPROM_IDLE 0xFFFFFFFF
+
+static uint8_t eeprom_cells[E2END + 1];
+static bool eeprom_erased = false;
+static uint32_t eeprom_done = NATIVE_EEPROM_IDLE; // virtual time the running write ends
+static uint16_t eeprom_address;
+static uint8_t eeprom_data, eeprom_mode;
+static uint32_t eeprom_writes;
+static uint32_t eeprom_wear[E2END + 1];
+static bool eeprom_in_isr;
+
+// EE_RDY is a level: it fires as long as the eeprom is ready and EERIE is set
+static void eeprom_ready()
+{
+    if (eeprom_in_isr || !EE_RDY_vect)
+        return;
+    eeprom_in_isr = true;
+    for (uint8_t i = 0; i < 16 && (EECR.value & _BV(EERIE)) && !(EECR.value & _BV(EEPE)); i++)
+        EE_RDY_vect();
+    eeprom_in_isr = false;
+}
+
+static void eeprom_finish()
+{
+    uint8_t &cell = eeprom_cells[eeprom_address & E2END];
+    if (eeprom_mode != _BV(EEPM1))
+        cell = 0xFF; // erase
+    if (eeprom_mode != _BV(EEPM0))
+        cell &= eeprom_data; // write only clears bits
+    eeprom_writes++;
+    eeprom_wear[eeprom_address & E2END]++;
+    eeprom_done = NATIVE_EEPROM_IDLE;
+    EECR.value &= ~_BV(EEPE);
+}
+
+// writes that end up to us complete, the ISR sees the time each one ended
+static void eeprom_until(uint32_t us)
+{
+    uint32_t now = virtual_us;
+    while (eeprom_done <= us)
+    {
+        if (eeprom_done > virtual_us)
+            virtual_us = eeprom_done;
+        eeprom_finish();
+        eeprom_ready();
+    }
+    virtual_us = now;
+}
+
+// a busy wait on EEPE takes until the write is done
+uint8_t native_hal_eecr()
+{
+    if ((EECR.value & _BV(EEPE)) && eeprom_done > virtual_us)
+        set_clock(eeprom_done);
+    return EECR.value;
+}
+
+NativeEecr &NativeEecr::operator=(uint8_t v)
+{
+    nativeHal::eeprom(); // erased on first use
+    uint8_t old = value;
+    value = v & ~(_BV(EERE) | _BV(EEPE));
+    if (old & _BV(EEPE))
+        value |= _BV(EEPE);
+    if ((v & _BV(EERE)) && !(old & _BV(EEPE)))
+        EEDR = eeprom_cells[EEAR & E2END]; // the cpu halts 4 cycles, nothing on the virtual clock
+    if ((v & _BV(EEPE)) && (old & _BV(EEMPE)) && !(old & _BV(EEPE)))
+    {
+        // EEMPE was set in the write before: start it, EEMPE clears itself
+        eeprom_address = EEAR;
+        eeprom_data = EEDR;
+        eeprom_mode = v & (_BV(EEPM1) | _BV(EEPM0));
+        eeprom_done = virtual_us + (eeprom_mode ? NATIVE_EEPROM_SPLIT_US : NATIVE_EEPROM_ATOMIC_US);
+        value = (value | _BV(EEPE)) & ~_BV(EEMPE);
+    }
+    if ((value & _BV(EERIE)) && !(old & _BV(EERIE)))
+        eeprom_ready();
+    return *this;
+}
+/* #endregion */
+
+/* #region usi */
+#define NATIVE_SDA 0 // PB0
+#define NATIVE_SCL 2 // PB2
+static uint32_t usi_interrupts;
+
+// an edge on SCL: the 4 bit counter counts both, the overflow interrupt comes on the 16th
+static void usi_edge()
+{
+    if (!(USICR & _BV(USICS1)))
+        return;
+    uint8_t count = (USISR + 1) & 0x0F;
+    USISR = (USISR & 0xF0) | count;
+    if (count == 0 && (USICR & _BV(USIOIE)) && USI_OVF_vect)
+    {
+        usi_interrupts++;
+        USI_OVF_vect();
+    }
+}
+
+// one clock of SCL with the controller on SDA, returns the level on the wire:
+// the target pulls it low while DDRB drives the pin and the msb of USIDR is 0.
+// the rising edge shifts the wire into USIDR
+static bool usi_clock(bool sda)
+{
+    bool wire = sda && !((DDRB & _BV(NATIVE_SDA)) && !(USIDR & 0x80));
+    if ((USICR & _BV(USIWM1)) && (USICR & _BV(USICS1)))
+        USIDR = (USIDR << 1) | wire;
+    usi_edge();
+    usi_edge();
+    return wire;
+}
+
+bool nativeHal::i2cStart(uint8_t address, bool read)
+{
+    // the controller pulls SCL low a few us after SDA, USI_START_vect runs before that
+    i2cStuckStart();
+    PINB &= ~_BV(NATIVE_SCL);
+    usi_edge();
+    return i2cWrite(address << 1 | read);
+}
+
+void nativeHal::i2cStuckStart()
+{
+    // SDA falls, SCL stays high
+    PINB = (PINB & ~_BV(NATIVE_SDA)) | _BV(NATIVE_SCL);
+    if ((USICR & _BV(USISIE)) && USI_START_vect)
+    {
+        usi_interrupts++;
+        USI_START_vect();
+    }
+}
+
+bool nativeHal::i2cWrite(uint8_t value)
+{
+    for (int8_t i = 7; i >= 0; i--)
+        usi_clock((value >> i) & 1);
+    return !usi_clock(1); // released, the target acks by pulling it low
+}
+
+uint8_t nativeHal::i2cRead(bool ack)
+{
+    uint8_t value = 0;
+    for (uint8_t i = 0; i < 8; i++)
+        value = (value << 1) | usi_clock(1);
+    usi_clock(!ack);
+    return value;
+}
+
+void nativeHal::i2cStop()
+{
+    PINB |= _BV(NATIVE_SDA) | _BV(NATIVE_SCL); // SDA rises while SCL is high, no interrupt
+}
+
+uint32_t nativeHal::i2cInterrupts() { return usi_interrupts; }
+/* #endregion */
+
+/* #region sleep */
+#define NATIVE_TIMER0_US 2048 // Timer0 (millis) overflows at 8 MHz / 64 / 256
+
+// the interrupt that ends an idle sleep: Timer0 always runs, Timer1 as set up
+static uint32_t next_wake(bool &compare)
+{
+    uint32_t wake = (virtual_us / NATIVE_TIMER0_US + 1) * NATIVE_TIMER0_US;
+    compare = false;
+    if ((EECR.value & _BV(EERIE)) && eeprom_done < wake)
+        wake = eeprom_done;
+    if (TCCR1 & 0x0F)
+    {
+        uint64_t now = timer1_ticks(virtual_us);
+        if (TIMSK & _BV(TOIE1))
+        {
+            uint32_t overflow = timer1_at((now | 0xFF) + 1);
+            if (overflow < wake)
+                wake = overflow;
+        }
+        if (TIMSK & _BV(OCIE1A))
+        {
+            uint8_t ahead = OCR1A - (uint8_t)now;
+            uint32_t match = timer1_at(now + (ahead ? ahead : 256));
+            if (match <= wake)
+            {
+                wake = match;
+                compare = true;
+            }
+        }
+    }
+    return wake;
+}
+
+void native_hal_sleep()
+{
+    bool compare;
+    uint32_t wake = next_wake(compare);
+    sleeps++;
+    if (sleep_hook)
+        sleep_hook(wake);
+    else
+        set_clock(wake);
+    if (compare && virtual_us >= wake && TIMER1_COMPA_vect)
+        TIMER1_COMPA_vect();
+}
+/* #endregion */
+
+/* #region Arduino */
+uint32_t micros() { return virtual_us; }
+uint32_t millis() { return virtual_us / 1000; }
+void delay(uint32_t ms) { set_clock(virtual_us + ms * 1000); }
+void delayMicroseconds(unsigned int us) { set_clock(virtual_us + us); }
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (mode == OUTPUT)
+        DDRB |= _BV(pin);
+    else
+        DDRB &= ~_BV(pin);
+}
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (val)
+        PORTB |= _BV(pin);
+    else
+        PORTB &= ~_BV(pin);
+}
+int digitalRead(uint8_t pin) { return (PINB >> pin) & 1; }
+
+static uint32_t random_state = 1;
+long random(long howbig)
+{
+    if (howbig == 0)
+        return 0;
+    random_state = random_state * 1103515245 + 12345;
+    return (random_state >> 1) % howbig;
+}
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+        return howsmall;
+    return random(howbig - howsmall) + howsmall;
+}
+void randomSeed(unsigned long seed) { random_state = seed ? seed : 1; }
+/* #endregion */
+
+/* #region nativeHal */
+void nativeHal::setMicros(uint32_t us) { set_clock(us); }
+void nativeHal::advanceMicros(uint32_t us) { set_clock(virtual_us + us); }
+void nativeHal::advanceMillis(uint32_t ms) { set_clock(virtual_us + ms * 1000); }
+
+void nativeHal::setPin(uint8_t pin, bool level)
+{
+    uint8_t old = PINB;
+    if (level)
+        PINB |= _BV(pin);
+    else
+        PINB &= ~_BV(pin);
+    if ((old ^ PINB) & PCMSK && (GIMSK & _BV(PCIE)))
+        PCINT0_vect();
+}
+
+void nativeHal::setShowHook(ShowHook hook) { show_hook = hook; }
+void nativeHal::setShowMicros(uint16_t us) { show_us = us; }
+uint32_t nativeHal::showCount() { return shows; }
+void nativeHal::setSleepHook(SleepHook hook) { sleep_hook = hook; }
+uint32_t nativeHal::sleepCount() { return sleeps; }
+
+uint8_t *nativeHal::eeprom()
+{
+    if (!eeprom_erased)
+    {
+        memset(eeprom_cells, 0xFF, sizeof(eeprom_cells)); // as it leaves the factory
+        eeprom_erased = true;
+    }
+    return eeprom_cells;
+}
+uint32_t nativeHal::eepromWrites() { return eeprom_writes; }
+uint32_t nativeHal::eepromWear(uint16_t address) { return eeprom_wear[address & E2END]; }
+
+void nativeHal::reset()
+{
+    virtual_us = 0;
+    shows = 0;
+    sleeps = 0;
+    PINB = 0xFF;
+    CLKPR = 0;
+    nativeHal::eeprom();
+    eeprom_done = NATIVE_EEPROM_IDLE;
+    eeprom_writes = 0;
+    EECR.value = 0;
+    USICR = USISR = USIDR = 0;
+    usi_interrupts = 0;
+    random_state = 1;
+    random16_set_seed(1337);
+}
+/* #endregion */
+
+// FastLED.show() lands here, see FastLED.cpp
+void native_hal_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness)
+{
+    shows++;
+    set_clock(virtual_us + show_us);
+    if (show_hook)
+        show_hook(leds ? leds[0].raw : nullptr, num_leds, brightness);
+}
@@ -0,0 +1,61 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+#include <Arduino.h>
+
+/**
+ * @brief control side of the host stand-in ([env:native] only)
+ * the firmware only ever sees a virtual clock: micros()/millis() return
+ * whatever the harness set, delay() advances it instead of sleeping.
+ * that keeps every run of a pattern or decoder benchmark deterministic.
+ */
+namespace nativeHal
+{
+  void setMicros(uint32_t us);
+  void advanceMicros(uint32_t us);
+  void advanceMillis(uint32_t ms);
+
+  // drive a PINB bit and fire PCINT0_vect, like a real pin change would
+  void setPin(uint8_t pin, bool level);
+
+  // called by FastLED.show() with the frame that would go out on the wire
+  typedef void (*ShowHook)(const uint8_t *rgb, uint16_t num_leds, uint8_t brightness);
+  void setShowHook(ShowHook hook);
+  // virtual time a show() takes, the real one runs with interrupts off:
+  // the harness should deliver edges that fall inside it only afterwards
+  void setShowMicros(uint16_t us);
+  uint32_t showCount();
+
+  // sleep_cpu() lands here with the virtual time the next timer interrupt would wake
+  // the core (Timer0 overflow, Timer1 overflow or compare A when enabled): the hook
+  // moves the clock up to it, or plays an ir edge that comes first.
+  // without a hook the clock jumps to the timer interrupt
+  typedef void (*SleepHook)(uint32_t wake_us);
+  void setSleepHook(SleepHook hook);
+  uint32_t sleepCount();
+
+  // the 512 bytes of eeprom, they keep their content over reset() like on the avr
+  uint8_t *eeprom();
+  uint32_t eepromWrites();               // bytes erased or written since reset()
+  uint32_t eepromWear(uint16_t address); // erases and writes of one byte, since the start
+
+  // an i2c controller on SDA (PB0) and SCL (PB2): every bit moves the USI like the wire would,
+  // USI_START_vect and USI_OVF_vect run when it raises them. a transfer takes no virtual time
+  bool i2cStart(uint8_t address, bool read); // start or repeated start and the address, true on ack
+  bool i2cWrite(uint8_t value);              // true on ack
+  uint8_t i2cRead(bool ack);                 // ack: more bytes to come
+  void i2cStop();
+  void i2cStuckStart();                      // a start condition and SCL never falls after it
+  uint32_t i2cInterrupts();                  // USI vectors run since reset()
+
+  // reset clock, registers, random seed and counters to power-on values
+  void reset();
+}
+
+extern "C" void PCINT0_vect(void);
+extern "C" void TIMER1_OVF_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void EE_RDY_vect(void) __attribute__((weak));
+extern "C" void USI_START_vect(void) __attribute__((weak));
+extern "C" void USI_OVF_vect(void) __attribute__((weak));
+
+#endif
@@ -0,0 +1,61 @@
+#include "clock.h"
+#include "data.h"
+
+// Timer0 at 8 MHz / 64 = 1 MHz / 8 = 125 kHz / 1, an 8 us tick like the core expects
+static inline uint8_t timer0_prescaler(uint8_t shift)
+{
+    return shift == 0 ? _BV(CS01) | _BV(CS00) : shift == 3 ? _BV(CS01) : _BV(CS00);
+}
+
+ClockScaler::ClockScaler()
+{
+    shift = 0;
+    resetStats();
+}
+
+void ClockScaler::set(uint8_t new_shift)
+{
+    uint8_t sreg = SREG;
+    cli();
+    CLKPR = _BV(CLKPCE);
+    CLKPR = new_shift; // within 4 cycles of CLKPCE
+    TCCR0B = (TCCR0B & ~(_BV(CS02) | _BV(CS01) | _BV(CS00))) | timer0_prescaler(new_shift);
+#if IR_TIMER1
+    // Timer1 CS1[3:0] = n divides by 2^(n - 1): CK/128 at 8 MHz, CK/16 at 1 MHz, CK/2 at 125 kHz
+    TCCR1 = (TCCR1 & 0xF0) | (8 - new_shift);
+#endif
+    SREG = sreg;
+    shift = new_shift;
+}
+
+void ClockScaler::fast()
+{
+    if (shift == 0)
+        return;
+    set(0);
+    slowUs += micros() - slowAt;
+}
+
+void ClockScaler::slow()
+{
+    if (shift == CLOCK_SLOW_SHIFT)
+        return;
+    set(CLOCK_SLOW_SHIFT);
+    slowAt = micros();
+    count_saturating(switches);
+}
+
+bool ClockScaler::isSlow() { return shift != 0; }
+uint16_t ClockScaler::getSwitchCount() { return switches; }
+
+uint32_t ClockScaler::getSlowMicros()
+{
+    return slowUs + (shift ? micros() - slowAt : 0);
+}
+
+void ClockScaler::resetStats()
+{
+    switches = 0;
+    slowUs = 0;
+    slowAt = micros();
+}
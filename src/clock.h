@@ -0,0 +1,45 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include <Arduino.h>
+
+/**
+ * @brief runtime clock prescaler (CLKPR)
+ * the fuses start the internal 8 MHz RC, FastLED.show() and streamShow() count
+ * their bit timing in cycles at that clock. in between, with the core mostly in
+ * idle sleep, it can run slower: idle and active current go down about with the clock.
+ * the timers run from the same clock, so every switch moves their prescalers along:
+ * Timer0 keeps its 8 us tick (millis() and micros() of the core stay right) and
+ * Timer1 its 16 us ir tick (the decoder windows stay right). Timer0 only divides by
+ * 1, 8, 64, 256 or 1024, so the slow clock is 1 MHz or 125 kHz.
+ * delay() and delayMicroseconds() count cycles, they only hold at 8 MHz.
+ */
+#ifndef CLOCK_SCALING
+#define CLOCK_SCALING 1 // 0: 8 MHz all the time
+#endif
+#ifndef CLOCK_SLOW_SHIFT
+#define CLOCK_SLOW_SHIFT 3 // slow clock F_CPU >> 3, 1 MHz
+#endif
+static_assert(CLOCK_SLOW_SHIFT == 3 || CLOCK_SLOW_SHIFT == 6, "Timer0 can only follow the clock down to 1 MHz or 125 kHz");
+
+class ClockScaler
+{
+private:
+  uint8_t shift;     // the clock is F_CPU >> shift
+  uint16_t switches; // to the slow clock since resetStats, saturates
+  uint32_t slowAt;   // micros() of the last switch to the slow clock
+  uint32_t slowUs;   // time spent at the slow clock since resetStats [microseconds]
+
+  void set(uint8_t new_shift);
+
+public:
+  ClockScaler();
+  void fast(); // 8 MHz, before the leds go out or while an ir frame comes in
+  void slow(); // CLOCK_SLOW_SHIFT, nothing but sleep to do
+  bool isSlow();
+
+  uint16_t getSwitchCount();
+  uint32_t getSlowMicros();
+  void resetStats();
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifdef IR_DEBUG_DUMP
+#include "debug_dump.h"
+
+#ifdef NATIVE_HAL
+#include <stdio.h>
+
+static void dumpByte(uint8_t byte)
+{
+    putchar(byte);
+}
+
+#else
+#define DEBUG_DUMP_DELAY 20 // 3 cycles per count, a bit is 10 + 3 * 20 = 70 cycles: 114286 baud at 8 MHz, -0.8 %
+
+// start bit, 8 data bits lsb first, stop bit. the carry holds the next bit,
+// ror shifts a 1 in at the top each time, the ninth one out is the stop bit
+static void dumpByte(uint8_t byte)
+{
+    uint8_t ctr, delay;
+    uint8_t sreg = SREG;
+    cli();
+    asm volatile(
+        "       ldi   %0,10  \n\t"
+        "       clc          \n\t" // start bit
+        "bit%=:              \n\t"
+        "       brcs  one%=  \n\t" // '1' [02] '0' [01]
+        "       cbi   %3,%4  \n\t" // '0' [03]
+        "       rjmp  wait%= \n\t" // '0' [05]
+        "one%=:              \n\t"
+        "       sbi   %3,%4  \n\t" // '1' [04]
+        "       nop          \n\t" // '1' [05]
+        "wait%=:             \n\t"
+        "       ldi   %1,%5  \n\t" // [06]
+        "delay%=:            \n\t"
+        "       dec   %1     \n\t"
+        "       brne  delay%=\n\t" // [05 + 3 * DEBUG_DUMP_DELAY]
+        "       sec          \n\t"
+        "       ror   %2     \n\t"
+        "       dec   %0     \n\t"
+        "       brne  bit%=  \n\t" // [10 + 3 * DEBUG_DUMP_DELAY]
+        : "=&d"(ctr), "=&d"(delay), "+r"(byte)
+        : "I"(_SFR_IO_ADDR(PORTB)), "I"(DEBUG_DUMP_PIN), "M"(DEBUG_DUMP_DELAY));
+    SREG = sreg;
+}
+#endif
+
+static void dumpText(const char *text) // PROGMEM
+{
+    for (char c; (c = pgm_read_byte(text)) != 0; text++)
+        dumpByte(c);
+}
+
+static void dumpNumber(uint16_t number)
+{
+    char digits[5];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + number % 10;
+        number /= 10;
+    } while (number);
+    while (count)
+        dumpByte(digits[--count]);
+}
+
+#if IR_TELEMETRY
+static void dumpList(const uint8_t *counts, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; i++)
+    {
+        if (i)
+            dumpByte(',');
+        dumpNumber(counts[i]);
+    }
+}
+#endif
+
+void debugDump()
+{
+    static bool started;
+    if (!started)
+    {
+        // the line idles high
+        PORTB |= _BV(DEBUG_DUMP_PIN);
+        DDRB |= _BV(DEBUG_DUMP_PIN);
+        started = true;
+    }
+
+#if IR_TELEMETRY
+    IrTelemetry t;
+    Data.takeTelemetry(t);
+    dumpText(PSTR("ir start "));
+    dumpNumber(t.framesStarted);
+    dumpText(PSTR(" done "));
+    dumpNumber(t.framesCompleted);
+    dumpText(PSTR(" idle "));
+    dumpNumber(t.idleEdges);
+    dumpText(PSTR(" reject "));
+    dumpList(t.rejected, eRejectReasons);
+    dumpText(PSTR(" overrun "));
+    dumpNumber(t.overruns);
+    dumpText(PSTR(" dup "));
+    dumpNumber(t.duplicates);
+    dumpText(PSTR(" crc "));
+    dumpNumber(t.crcFailures);
+    dumpText(PSTR(" team "));
+    dumpList(t.teams, sizeof(t.teams));
+    dumpText(PSTR(" action "));
+    dumpList(t.actions, sizeof(t.actions));
+    dumpText(PSTR("\r\n"));
+#endif
+
+#if IR_HISTOGRAM
+    // bins of IR_HISTOGRAM_BIN_US, the last one is everything longer
+    IrHistogram h;
+    Data.stopCapture();
+    Data.readHistogram(h);
+    Data.startCapture();
+    dumpText(PSTR("us/"));
+    dumpNumber(IR_HISTOGRAM_BIN_US);
+    for (uint16_t count : h.bins)
+    {
+        dumpByte(' ');
+        dumpNumber(count);
+    }
+    dumpText(PSTR("\r\n"));
+#endif
+}
+#endif
@@ -0,0 +1,26 @@
+#ifndef DEBUG_DUMP_H
+#define DEBUG_DUMP_H
+#include <Arduino.h>
+#include "data.h"
+
+/**
+ * @brief decoder telemetry out on a spare pin, for when shots don't register
+ * a transmit only uart bit banged on PB1 at 115200 8N1, a usb serial adapter
+ * on PB1 and GND reads it. debugDump() prints one line of the counters since
+ * the last dump, and with IR_HISTOGRAM the pulse widths captured meanwhile.
+ * interrupts are only off while a byte goes out (87 us), loop() dumps between
+ * ir frames, an edge delayed that much at the start of a frame is still in window.
+ * on the host the line goes to stdout.
+ */
+#ifndef DEBUG_DUMP_PIN
+#define DEBUG_DUMP_PIN 1 // PB1
+#endif
+#ifndef DEBUG_DUMP_SECONDS
+#define DEBUG_DUMP_SECONDS 5
+#endif
+static_assert(IR_TELEMETRY || IR_HISTOGRAM, "the debug dump needs IR_TELEMETRY or IR_HISTOGRAM");
+static_assert((ir_receiver_mask() & (1 << DEBUG_DUMP_PIN)) == 0, "the debug dump pin is an ir receiver");
+
+void debugDump();
+
+#endif
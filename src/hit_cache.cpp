@@ -0,0 +1,83 @@
+#include "hit_cache.h"
+
+#define HIT_CACHE_FREE 0xFFFF
+
+// team in bits 12..14 over the player_id, never HIT_CACHE_FREE
+static inline uint16_t key_of(IrDataPacket packet)
+{
+    return (uint16_t)packet.get_team() << IrDataPacket::PlayerId::width | packet.get_player_id();
+}
+
+// players tend to be numbered in a row: fold every nibble in
+static inline uint8_t set_of(uint16_t key)
+{
+    uint8_t folded = (uint8_t)key ^ (uint8_t)(key >> 8);
+    return (folded ^ (folded >> 4)) & (HIT_CACHE_SETS - 1);
+}
+
+HitCache::HitCache()
+{
+    window = HIT_CACHE_WINDOW_MS;
+    reset();
+}
+
+bool HitCache::accept(IrDataPacket packet, uint16_t now)
+{
+    uint16_t key = key_of(packet);
+    HitCacheEntry *set = entries[set_of(key)];
+    HitCacheEntry *victim = &set[0];
+    uint16_t victim_age = 0;
+    for (uint8_t way = 0; way < HIT_CACHE_WAYS; way++)
+    {
+        HitCacheEntry &entry = set[way];
+        uint16_t age = now - entry.at;
+        if (entry.key == key)
+        {
+            if (age < window)
+            {
+                count_saturating(repeats);
+                return false;
+            }
+            entry.at = now;
+            victim = nullptr;
+            break;
+        }
+        if (entry.key == HIT_CACHE_FREE)
+            age = 0xFFFF; // free ways go first
+        if (age >= victim_age)
+        {
+            victim = &entry;
+            victim_age = age;
+        }
+    }
+    if (victim)
+    {
+        victim->key = key;
+        victim->at = now;
+    }
+    count_saturating(tallies[packet.get_team()]);
+    return true;
+}
+
+void HitCache::expire(uint16_t now)
+{
+    for (HitCacheEntry(&set)[HIT_CACHE_WAYS] : entries)
+        for (HitCacheEntry &entry : set)
+            if ((uint16_t)(now - entry.at) >= window)
+                entry.key = HIT_CACHE_FREE;
+}
+
+void HitCache::setWindow(uint16_t ms)
+{
+    window = ms > HIT_CACHE_MAX_WINDOW_MS ? HIT_CACHE_MAX_WINDOW_MS : ms;
+}
+
+void HitCache::reset()
+{
+    memset(entries, 0xFF, sizeof(entries)); // free
+    memset(tallies, 0, sizeof(tallies));
+    repeats = 0;
+}
+
+uint16_t HitCache::getTally(uint8_t team) { return tallies[team & 7]; }
+uint16_t HitCache::getRepeatCount() { return repeats; }
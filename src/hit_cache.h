@@ -0,0 +1,63 @@
+#ifndef HIT_CACHE_H
+#define HIT_CACHE_H
+#include <Arduino.h>
+#include "data.h"
+
+/**
+ * @brief the players that hit us lately: one trigger pull counts once
+ * a blaster sends its frame more than once per pull and a reflection can decode on its
+ * own, _data only drops the same frame seen by several receivers at once. accept()
+ * takes a hit unless the same player of the same team had one taken within the window
+ * before. the window runs from the hit taken, repeats don't move it: a burst counts once
+ * as long as it fits in the window, sustained fire counts once per window.
+ * the players live in HIT_CACHE_SETS sets of HIT_CACHE_WAYS (set by a hash of player
+ * and team), a lookup only compares the ways of one set, a new player takes the way
+ * taken longest ago. a player pushed out that soon hits again counts again: 16 players
+ * fit, more than that within a window fill the air so far that the repeats of a pull
+ * come further apart than the window anyway.
+ * times are 16 bit millis(), expire() every HIT_CACHE_SWEEP_SECONDS drops what is
+ * older than the window before the clock wraps around to it (65 s).
+ */
+#ifndef HIT_CACHE
+#define HIT_CACHE 0 // 1: repeats of a trigger pull count once, 84 bytes of ram; 0: every decoded hit counts
+#endif
+#ifndef HIT_CACHE_WINDOW_MS
+#define HIT_CACHE_WINDOW_MS 450 // a pull within this is one, up to 4 frames of 50..90 ms 10..30 ms apart
+#endif
+#ifndef HIT_CACHE_SETS
+#define HIT_CACHE_SETS 8
+#endif
+#ifndef HIT_CACHE_WAYS
+#define HIT_CACHE_WAYS 2
+#endif
+#define HIT_CACHE_SWEEP_SECONDS 10
+#define HIT_CACHE_MAX_WINDOW_MS (0xFFFFU - HIT_CACHE_SWEEP_SECONDS * 1000U)
+static_assert((HIT_CACHE_SETS & (HIT_CACHE_SETS - 1)) == 0, "HIT_CACHE_SETS must be a power of two");
+static_assert(HIT_CACHE_WINDOW_MS <= HIT_CACHE_MAX_WINDOW_MS, "the window has to end before the 16 bit ms wrap");
+
+struct HitCacheEntry
+{
+  uint16_t key; // team and player_id, 0xFFFF = free
+  uint16_t at;  // millis() of the hit of it taken last, the start of its window
+};
+
+class HitCache
+{
+private:
+  HitCacheEntry entries[HIT_CACHE_SETS][HIT_CACHE_WAYS];
+  uint16_t window;     // [ms]
+  uint16_t tallies[8]; // accepted hits by TeamColor, saturate
+  uint16_t repeats;    // hits dropped as repeats, saturates
+
+public:
+  HitCache();
+  bool accept(IrDataPacket packet, uint16_t now); // false for a repeat within the window
+  void expire(uint16_t now);                      // free the players older than the window
+  void setWindow(uint16_t ms);                    // up to HIT_CACHE_MAX_WINDOW_MS
+  void reset();                                   // forget the players and clear the tallies
+
+  uint16_t getTally(uint8_t team);
+  uint16_t getRepeatCount();
+};
+
+#endif
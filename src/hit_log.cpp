@@ -0,0 +1,154 @@
+#include "hit_log.h"
+
+#if HIT_LOG
+#define HIT_LOG_ERASED 0xFF
+#define HIT_LOG_ERASE_ONLY _BV(EEPM0) // 1.8 ms
+#define HIT_LOG_WRITE_ONLY _BV(EEPM1) // 1.8 ms, can only clear bits
+#define HIT_LOG_ATOMIC 0              // 3.4 ms, erase and write
+
+HitLog hitLog;
+
+ISR(EE_RDY_vect)
+{
+    hitLog.writeStep();
+}
+
+// call with interrupts off and no write running
+uint8_t HitLog::readByte(uint16_t address)
+{
+    EEAR = address;
+    EECR |= _BV(EERE);
+    return EEDR;
+}
+
+// call with interrupts off and no write running, EE_RDY_vect comes when it is done
+void HitLog::program(uint16_t address, uint8_t value, uint8_t mode)
+{
+    EEAR = address;
+    EEDR = value;
+    EECR = mode | _BV(EERIE) | _BV(EEMPE);
+    EECR |= _BV(EEPE); // within 4 cycles of EEMPE
+}
+
+uint8_t HitLog::following(uint8_t seq)
+{
+    return seq == HIT_LOG_ERASED - 1 ? 0 : seq + 1;
+}
+
+void HitLog::begin()
+{
+    queue.clear();
+    step = 0;
+    drops = 0;
+
+    // the newest record is the one the next slot doesn't follow, there is one unless the ring is empty
+    newest = HIT_LOG_SLOTS - 1;
+    seq = HIT_LOG_ERASED - 1; // the first record gets 0
+    uint8_t last = readByte((HIT_LOG_SLOTS - 1) * HIT_LOG_RECORD);
+    for (uint8_t slot = 0; slot < HIT_LOG_SLOTS; slot++)
+    {
+        uint8_t current = readByte(slot * HIT_LOG_RECORD);
+        if (last != HIT_LOG_ERASED && current != following(last))
+        {
+            newest = slot == 0 ? HIT_LOG_SLOTS - 1 : slot - 1;
+            seq = last;
+        }
+        last = current;
+    }
+
+    // back from it as long as the sequence does, a slot written halfway breaks it
+    uint8_t slot = newest, expected = seq;
+    records = 0;
+    while (records < HIT_LOG_SLOTS && readByte(slot * HIT_LOG_RECORD) == expected && expected != HIT_LOG_ERASED)
+    {
+        records++;
+        slot = slot == 0 ? HIT_LOG_SLOTS - 1 : slot - 1;
+        expected = expected == 0 ? HIT_LOG_ERASED - 1 : expected - 1;
+    }
+}
+
+bool HitLog::log(IrDataPacket packet)
+{
+    if (queue.full())
+    {
+        count_saturating(drops);
+        return false;
+    }
+    uint32_t bits = packet.get_raw() >> IrDataPacket::Team::offset;
+    volatile uint8_t *entry = queue.back();
+    entry[0] = bits;
+    entry[1] = bits >> 8;
+    entry[2] = (bits >> 16) & 0x1F; // up to the last bit of player_id
+    queue.push();                   // hand the entry to the ISR only after it is filled
+    EECR |= _BV(EERIE);             // EE_RDY_vect right away if the eeprom is idle
+    return true;
+}
+
+// one byte per call: the seq byte is erased first, then the data bytes that differ, the seq byte last
+void HitLog::writeStep()
+{
+    if (queue.empty())
+    {
+        EECR &= ~_BV(EERIE); // nothing queued, EE_RDY would fire over and over
+        return;
+    }
+    uint8_t slot = newest + 1 == HIT_LOG_SLOTS ? 0 : newest + 1;
+    uint16_t address = slot * HIT_LOG_RECORD;
+    if (step == 0)
+    {
+        step = 1;
+        if (records == HIT_LOG_SLOTS)
+            records--; // the oldest record is overwritten
+        if (readByte(address) != HIT_LOG_ERASED)
+        {
+            program(address, HIT_LOG_ERASED, HIT_LOG_ERASE_ONLY);
+            return;
+        }
+    }
+    const volatile uint8_t *entry = queue.front();
+    while (step <= HIT_LOG_BYTES)
+    {
+        uint8_t value = entry[step - 1];
+        uint8_t old = readByte(address + step);
+        step++;
+        if (old != value)
+        {
+            // a byte that only needs bits cleared skips the erase
+            program(address + step - 1, value, (old & value) == value ? HIT_LOG_WRITE_ONLY : HIT_LOG_ATOMIC);
+            return;
+        }
+    }
+    seq = following(seq);
+    program(address, seq, HIT_LOG_WRITE_ONLY);
+    newest = slot;
+    records++;
+    step = 0;
+    queue.pop(); // the entry is free again
+}
+
+uint8_t HitLog::count() { return records; }
+uint8_t HitLog::pending() { return queue.size(); }
+uint8_t HitLog::getDropCount() { return drops; }
+
+IrDataPacket HitLog::read(uint8_t index)
+{
+    uint8_t sreg = SREG;
+    for (;;)
+    {
+        cli(); // newest and records don't change while the eeprom is read
+        if (!(EECR & _BV(EEPE)))
+            break;
+        SREG = sreg; // the write before takes up to 3.4 ms, not with interrupts off
+    }
+    uint32_t bits = 0;
+    if (index < records)
+    {
+        uint8_t slot = (newest + HIT_LOG_SLOTS - (records - 1) + index) % HIT_LOG_SLOTS;
+        uint16_t address = slot * HIT_LOG_RECORD;
+        for (uint8_t i = HIT_LOG_BYTES; i > 0; i--)
+            bits = bits << 8 | readByte(address + i);
+    }
+    SREG = sreg;
+    return IrDataPacket(bits << IrDataPacket::Team::offset);
+}
+#endif
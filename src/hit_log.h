@@ -0,0 +1,61 @@
+#ifndef HIT_LOG_H
+#define HIT_LOG_H
+#include <Arduino.h>
+#include "data.h"
+
+/**
+ * @brief the hits taken, kept in eeprom over power cycles
+ * a byte of eeprom takes 3.4 ms to erase and write, far too long to wait for in loop():
+ * log() only queues the packet, EE_RDY_vect programs it a byte at a time while loop()
+ * goes on, and the next byte starts when the last one is done.
+ * the 512 bytes are a ring of HIT_LOG_SLOTS records, each written once per trip
+ * around it, so the wear spreads evenly: 100k cycles per cell make 12.8 million hits.
+ * a record is a sequence byte and the packet without channel and crc:
+ *   seq  team action param player_id (bits 1..21 of the packet, 3 bytes little endian)
+ * the sequence counts 0..254 around, 0xFF is an erased or half written slot: it is
+ * erased first and written last, a reset in between loses that one hit, no more.
+ * begin() finds the newest record as the one the next slot's sequence doesn't follow.
+ * the eeprom is wiped by a chip erase unless the EESAVE fuse is programmed (hfuse 0xD7).
+ */
+#ifndef HIT_LOG
+#define HIT_LOG 0 // 1: hits logged to eeprom, takes EE_RDY_vect and 19 bytes of ram
+#endif
+#ifndef HIT_LOG_QUEUE
+#define HIT_LOG_QUEUE 4 // hits waiting for the eeprom, a record takes 7..14 ms
+#endif
+#define HIT_LOG_RECORD 4
+#define HIT_LOG_SLOTS ((E2END + 1) / HIT_LOG_RECORD)
+static_assert(HIT_LOG_SLOTS < 255, "the sequence has to skip values around the ring");
+static_assert(IrDataPacket::Team::offset == 1 && IrDataPacket::PlayerId::next == 22,
+              "a record keeps the bits from team to player_id");
+
+#define HIT_LOG_BYTES 3 // of the packet in a record
+
+class HitLog
+{
+private:
+  SpscRing<uint8_t[HIT_LOG_BYTES], HIT_LOG_QUEUE> queue; // loop() pushes, the ISR pops once the record is written
+  uint8_t step;             // of the record being written: 0 erase seq, 1..3 data, 4 seq
+  uint8_t newest;           // slot of the newest complete record
+  uint8_t seq;              // its sequence
+  volatile uint8_t records; // complete records in the ring
+  uint8_t drops;            // hits lost on a full queue, saturates
+
+  static uint8_t readByte(uint16_t address);
+  static void program(uint16_t address, uint8_t value, uint8_t mode);
+  static uint8_t following(uint8_t seq);
+
+public:
+  void begin();                  // find the newest record, call before sei()
+  bool log(IrDataPacket packet); // queue a hit, false if the queue is full
+  void writeStep();              // EE_RDY_vect: start the next eeprom write
+
+  uint8_t count();                          // records in the ring
+  uint8_t pending();                        // hits still waiting for the eeprom
+  IrDataPacket read(uint8_t index);         // record 'index', 0 is the oldest: channel and crc read 0
+  uint8_t getDropCount();
+};
+
+extern HitLog hitLog;
+
+#endif
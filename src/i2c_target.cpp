@@ -0,0 +1,218 @@
+#include "i2c_target.h"
+
+#if I2C_TARGET
+enum I2cState : uint8_t
+{
+  eI2cStarting,  // the start condition holds SCL high still, the counter overflows when it falls
+  eI2cAddress,   // the address byte comes in
+  eI2cSend,      // acked, the first byte for the host goes out next
+  eI2cAckIn,     // a byte went out, the host's ack comes in next
+  eI2cCheckAck,  // the ack is in
+  eI2cReceive,   // acked, a byte from the host comes in next
+  eI2cReceived,  // a byte from the host is in
+};
+
+#define USISR_CLEAR (_BV(USISIF) | _BV(USIOIF) | _BV(USIPF) | _BV(USIDC))
+#define USISR_BYTE 0x0 // the counter counts both clock edges: 16 to overflow
+#define USISR_BIT 0xE  // 2 edges, the ack
+#define USISR_EDGE 0xF // 1 edge, the fall of SCL that ends the start condition
+#define USICR_IDLE (_BV(USISIE) | _BV(USIWM1) | _BV(USICS1))
+#define USICR_TRANSFER (_BV(USISIE) | _BV(USIOIE) | _BV(USIWM1) | _BV(USIWM0) | _BV(USICS1)) // SCL held low on overflow
+
+I2cTarget i2cTarget;
+
+ISR(USI_START_vect)
+{
+    i2cTarget.start();
+}
+
+ISR(USI_OVF_vect)
+{
+    i2cTarget.overflow();
+}
+
+// SDA released, only the start condition detector on
+static inline void wait_for_start()
+{
+    DDRB &= ~_BV(I2C_SDA_PIN);
+    USICR = USICR_IDLE;
+    USISR = USISR_CLEAR;
+}
+
+static inline void send_ack()
+{
+    USIDR = 0;
+    DDRB |= _BV(I2C_SDA_PIN);
+    USISR = USISR_CLEAR | USISR_BIT;
+}
+
+void I2cTarget::begin()
+{
+    queue.clear();
+    pattern = 0xFF;
+    brightnessSet = false;
+    status.version = I2C_PROTOCOL_VERSION;
+    status.dropped = 0;
+    PORTB |= _BV(I2C_SDA_PIN) | _BV(I2C_SCL_PIN);
+    DDRB |= _BV(I2C_SCL_PIN); // the USI pulls it low only while it holds the clock
+    wait_for_start();
+}
+
+void I2cTarget::push(IrDataPacket packet)
+{
+    if (queue.full())
+    {
+        status.dropped++;
+        return;
+    }
+    queue.back() = packet.get_raw();
+    queue.push(); // hand it to the ISR only after it is written
+}
+
+void I2cTarget::update(const I2cStatus &snapshot)
+{
+    uint8_t sreg = SREG;
+    cli(); // the ISR reads it a byte at a time, no half updated counters
+    uint8_t dropped = status.dropped;
+    status = snapshot;
+    status.version = I2C_PROTOCOL_VERSION;
+    status.dropped = dropped;
+    SREG = sreg;
+}
+
+bool I2cTarget::takePattern(uint8_t &number)
+{
+    uint8_t sreg = SREG;
+    cli();
+    number = pattern;
+    pattern = 0xFF;
+    SREG = sreg;
+    return number != 0xFF;
+}
+
+bool I2cTarget::takeBrightness(uint8_t &level)
+{
+    uint8_t sreg = SREG;
+    cli();
+    bool set = brightnessSet;
+    level = brightness;
+    brightnessSet = false;
+    SREG = sreg;
+    return set;
+}
+
+// ISR: the byte to shift out now
+uint8_t I2cTarget::nextByte()
+{
+    fromQueue = false;
+    switch (reg)
+    {
+    case eI2cStatus:
+        return index < sizeof(status) ? ((const uint8_t *)&status)[index] : 0xFF;
+    case eI2cPackets:
+        if (index == 0)
+            return queue.size();
+        if (queue.empty())
+            return 0;
+        fromQueue = true;
+        return ((const volatile uint8_t *)&queue.front())[offset]; // the avr is little endian
+    default:
+        return 0xFF;
+    }
+}
+
+// ISR: the byte from nextByte() is through, acked or not
+void I2cTarget::sent()
+{
+    if (fromQueue && ++offset == sizeof(uint32_t))
+    {
+        offset = 0;
+        queue.pop(); // the packet is the host's
+    }
+    if (index != 0xFF)
+        index++;
+}
+
+// ISR: the first byte of a write picks the register
+void I2cTarget::received(uint8_t value)
+{
+    if (index == 0)
+        reg = value;
+    else if (reg == eI2cPattern)
+        pattern = value;
+    else if (reg == eI2cBrightness)
+    {
+        brightness = value;
+        brightnessSet = true;
+    }
+    if (index != 0xFF)
+        index++;
+}
+
+void I2cTarget::start()
+{
+    DDRB &= ~_BV(I2C_SDA_PIN);
+    USICR = USICR_TRANSFER;
+    // the start condition is over once SCL is low. it isn't waited for in here, the ir edges
+    // would wait along: the counter takes that edge, a stop instead leaves it for the next start
+    state = (PINB & _BV(I2C_SCL_PIN)) ? eI2cStarting : eI2cAddress;
+    USISR = USISR_CLEAR | (state == eI2cStarting ? USISR_EDGE : USISR_BYTE);
+}
+
+void I2cTarget::overflow()
+{
+    switch (state)
+    {
+    case eI2cStarting:
+        state = eI2cAddress;
+        USISR = USISR_CLEAR | USISR_BYTE;
+        return;
+
+    case eI2cAddress:
+        if ((USIDR >> 1) != I2C_ADDRESS)
+        {
+            wait_for_start();
+            return;
+        }
+        state = (USIDR & 1) ? eI2cSend : eI2cReceive;
+        index = 0;
+        offset = 0; // a packet read halfway goes out again from its start
+        send_ack();
+        return;
+
+    case eI2cCheckAck:
+        sent();
+        if (USIDR & 1)
+        {
+            wait_for_start(); // nack: the host has all it wants
+            return;
+        }
+        // fall through
+    case eI2cSend:
+        USIDR = nextByte();
+        state = eI2cAckIn;
+        DDRB |= _BV(I2C_SDA_PIN);
+        USISR = USISR_CLEAR | USISR_BYTE;
+        return;
+
+    case eI2cAckIn:
+        state = eI2cCheckAck;
+        DDRB &= ~_BV(I2C_SDA_PIN);
+        USIDR = 0;
+        USISR = USISR_CLEAR | USISR_BIT;
+        return;
+
+    case eI2cReceive:
+        state = eI2cReceived;
+        DDRB &= ~_BV(I2C_SDA_PIN);
+        USISR = USISR_CLEAR | USISR_BYTE;
+        return;
+
+    case eI2cReceived:
+        received(USIDR);
+        state = eI2cReceive;
+        send_ack();
+        return;
+    }
+}
+#endif
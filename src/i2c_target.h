@@ -0,0 +1,92 @@
+#ifndef I2C_TARGET_H
+#define I2C_TARGET_H
+#include <Arduino.h>
+#include "data.h"
+
+/**
+ * @brief i2c target on the USI, SDA on PB0 and SCL on PB2
+ * a host (the badge) reads the decoded packets, the decoder counters and the running
+ * pattern, and sets the pattern and the brightness. registers, I2cRegister below:
+ * a write sets the register with its first byte, the bytes after it are the value,
+ * a read returns from the register written last.
+ * the USI shifts the bits in hardware and holds SCL low after each byte (clock
+ * stretching) until its overflow interrupt had a look, so the ISRs only take or hand
+ * over a byte: a few dozen cycles, an ir edge waits that much at most. USI_START_vect
+ * doesn't wait for SCL to fall after the start condition either, the counter overflows
+ * on that edge and USI_OVF_vect goes on with the address from there.
+ * loop() copies every packet readIr hands out into a queue of its own, 4 bytes each:
+ * the decoder's queues hold raw frames per receiver that readIr checks, merges and
+ * drains every pass, the host reads at its own pace. the bytes go out straight from
+ * that copy, a packet leaves it once its last byte is through. the host has to allow clock stretching: while FastLED.show()
+ * runs (interrupts off) a byte waits up to SHOW_US.
+ */
+#ifndef I2C_TARGET
+#define I2C_TARGET 0 // 1: the i2c target on PB0 and PB2, 40 bytes of ram; 0: the pins stay free
+#endif
+#ifndef I2C_ADDRESS
+#define I2C_ADDRESS 0x42 // 7 bit
+#endif
+#ifndef I2C_QUEUE
+#define I2C_QUEUE 4 // packets waiting for the host, a frame takes 50..90 ms
+#endif
+#define I2C_SDA_PIN 0 // PB0
+#define I2C_SCL_PIN 2 // PB2
+#define I2C_PROTOCOL_VERSION 1
+static_assert(!I2C_TARGET || (ir_receiver_mask() & (_BV(I2C_SDA_PIN) | _BV(I2C_SCL_PIN))) == 0,
+              "an ir receiver is on an i2c pin, build with -DI2C_TARGET=0");
+
+enum I2cRegister : uint8_t
+{
+  eI2cStatus = 0x00,     // read: I2cStatus
+  eI2cPackets = 0x01,    // read: packets waiting (1 byte), then IrDataPackets of 4 bytes lsb first, 0 once none are left.
+                         // as readIr hands them out: the crc checked and cleared
+  eI2cPattern = 0x10,    // write: gPatterns index, it crossfades in
+  eI2cBrightness = 0x11, // write: FastLED brightness
+};
+
+// the eI2cStatus register, lsb first
+struct I2cStatus
+{
+  uint8_t version;     // I2C_PROTOCOL_VERSION
+  uint8_t pattern;     // running gPatterns index
+  uint8_t brightness;
+  uint8_t overflows;   // Data.getOverflowCount(), wraps
+  uint16_t received;   // Data.getReceivedCount(), wraps
+  uint8_t duplicates;  // Data.getDuplicateCount(), wraps
+  uint8_t dropped;     // packets the host didn't read in time, wraps
+  uint16_t tallies[3]; // hits counted for rex, giggle and buzz (HIT_CACHE), saturate
+};
+static_assert(sizeof(I2cStatus) == 14, "the host sees the status as packed bytes");
+
+class I2cTarget
+{
+private:
+  SpscRing<uint32_t, I2C_QUEUE> queue; // IrDataPacket raw values, loop() pushes, the ISR pops
+  I2cStatus status;                   // written by loop() under cli()
+  uint8_t state;                      // of the transfer, ISR only
+  uint8_t reg;                        // I2cRegister
+  uint8_t index;                      // byte of the transfer, saturates
+  uint8_t offset;                     // byte of the packet going out
+  bool fromQueue;                     // the byte going out is one of a queued packet
+  volatile uint8_t pattern;           // from the host, 0xFF none
+  volatile uint8_t brightness;
+  volatile bool brightnessSet;
+
+  uint8_t nextByte();
+  void sent();
+  void received(uint8_t value);
+
+public:
+  void begin();
+  void push(IrDataPacket packet);         // for the host, dropped and counted when it isn't reading
+  void update(const I2cStatus &snapshot); // everything but the version and the drops
+  bool takePattern(uint8_t &number);
+  bool takeBrightness(uint8_t &level);
+
+  void start();    // USI_START_vect
+  void overflow(); // USI_OVF_vect
+};
+
+extern I2cTarget i2cTarget;
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+#include <Arduino.h>
+#include <FastLED.h>
+
+/**
+ * @brief where the leds of the hat are, known at compile time
+ * a segment is a range of pixels in a direction, patterns are templated on the
+ * segments they paint, so the bounds fold into the code: no CRGBSet built at
+ * runtime, short segments are unrolled.
+ * the layout is picked at build time, -DLAYOUT_STRIP=n targets a plain strip.
+ */
+#define SEGMENT_UNROLL 4 // segments up to this many pixels are unrolled, longer ones loop
+
+// calls f(position) for position 0 .. N-1
+template <uint16_t N, bool UNROLL = (N <= SEGMENT_UNROLL)>
+struct SegmentLoop
+{
+  template <typename F>
+  static inline void run(F &f)
+  {
+    for (uint16_t i = 0; i < N; i++)
+      f(i);
+  }
+};
+
+template <uint16_t N>
+struct SegmentLoop<N, true>
+{
+  template <typename F>
+  static inline void run(F &f)
+  {
+    SegmentLoop<N - 1, true>::run(f);
+    f(N - 1);
+  }
+};
+
+template <>
+struct SegmentLoop<0, true>
+{
+  template <typename F>
+  static inline void run(F &) {}
+};
+
+// pixels FIRST to LAST, LAST < FIRST runs backwards
+template <uint16_t FIRST, uint16_t LAST>
+struct Segment
+{
+  static constexpr bool reversed = LAST < FIRST;
+  static constexpr uint16_t size = reversed ? FIRST - LAST + 1 : LAST - FIRST + 1;
+
+  static constexpr uint16_t at(uint16_t position) { return reversed ? FIRST - position : FIRST + position; }
+  static constexpr bool contains(uint16_t index) { return reversed ? index <= FIRST && index >= LAST : index >= FIRST && index <= LAST; }
+  static constexpr uint16_t position(uint16_t index) { return reversed ? FIRST - index : index - FIRST; } // 0 at FIRST
+
+  // f(pixel, position) for every pixel in order
+  template <typename F>
+  static inline void each(F f)
+  {
+    auto step = [&](uint16_t position) { f(at(position), position); };
+    SegmentLoop<size>::run(step);
+  }
+
+  static inline void fill(CRGB *leds, const CRGB &color)
+  {
+    each([&](uint16_t pixel, uint16_t) { leds[pixel] = color; });
+  }
+};
+
+// the same pixels the other way round
+template <typename S>
+using Reversed = Segment<S::at(S::size - 1), S::at(0)>;
+
+// two segments that show the same, position by position: the eyes, halves from the middle out
+template <typename A, typename B>
+struct Mirrored
+{
+  static_assert(A::size == B::size, "Mirrored segments have the same size");
+  static constexpr uint16_t size = A::size;
+
+  static constexpr bool contains(uint16_t index) { return A::contains(index) || B::contains(index); }
+  static constexpr uint16_t position(uint16_t index) { return A::contains(index) ? A::position(index) : B::position(index); }
+
+  template <typename F>
+  static inline void each(F f)
+  {
+    auto step = [&](uint16_t position) {
+      f(A::at(position), position);
+      f(B::at(position), position);
+    };
+    SegmentLoop<size>::run(step);
+  }
+
+  static inline void fill(CRGB *leds, const CRGB &color)
+  {
+    each([&](uint16_t pixel, uint16_t) { leds[pixel] = color; });
+  }
+};
+
+// the hat, doc/ has the schematic
+struct HatLayout
+{
+  static constexpr uint16_t num_leds = 10;
+  typedef Segment<0, 9> All;
+  typedef Segment<0, 4> FirstHalf;
+  typedef Segment<5, 9> SecondHalf;
+  typedef Segment<4, 4> LeftEye;
+  typedef Segment<5, 5> RightEye;
+  typedef Mirrored<LeftEye, RightEye> Eyes;
+  typedef Segment<8, 8> LogoLeft;
+  typedef Segment<9, 9> LogoRight;
+  typedef Segment<8, 9> Logo;
+};
+
+// a plain strip of N, the hat's parts in the middle and at the end
+template <uint16_t N>
+struct StripLayout
+{
+  static_assert(N >= 4, "StripLayout needs room for the eyes and the logo");
+  static constexpr uint16_t num_leds = N;
+  typedef Segment<0, N - 1> All;
+  typedef Segment<0, N / 2 - 1> FirstHalf;
+  typedef Segment<N / 2, N - 1> SecondHalf;
+  typedef Segment<N / 2 - 1, N / 2 - 1> LeftEye;
+  typedef Segment<N / 2, N / 2> RightEye;
+  typedef Mirrored<LeftEye, RightEye> Eyes;
+  typedef Segment<N - 2, N - 2> LogoLeft;
+  typedef Segment<N - 1, N - 1> LogoRight;
+  typedef Segment<N - 2, N - 1> Logo;
+};
+
+#ifdef LAYOUT_STRIP
+typedef StripLayout<LAYOUT_STRIP> Layout;
+#else
+typedef HatLayout Layout;
+#endif
+
+#endif
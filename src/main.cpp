@@ -2,46 +2,79 @@
 #include <FastLED.h>
 
 #include "data.h"
+#include "bench_mark.h"
+#include "scheduler.h"
+#include "power.h"
+#include "clock.h"
+#include "hit_log.h"
+#include "hit_cache.h"
+#include "i2c_target.h"
+#ifdef IR_DEBUG_DUMP
+#include "debug_dump.h"
+#endif
+#include "patterns.h"
+#if __has_include("baked_stream.h")
+#include "baked_stream.h" // tools/bake/bake.py, without it there is no bakedAnimation
+#endif
+#include "stream_patterns.h"
 
 // pin numbers, the blue colored ones in doc/attiny85-guide-pinout.png
 #define LED_PIN 3
 // #define IR_RX_PIN 4  // defined in "data.h"
-// #define SCL 2
-// #define SDA 0
+// #define SCL 2  // I2C_SCL_PIN in "i2c_target.h"
+// #define SDA 0  // I2C_SDA_PIN in "i2c_target.h"
 
-#define NUM_LEDS 10
+// #define NUM_LEDS 10  // defined in "patterns.h"
 #define BRIGHTNESS 255
 #define LED_TYPE WS2812
 #define COLOR_ORDER GRB
-#define FRAMES_PER_SECOND 60
+#define FRAME_US (1000000UL / FRAMES_PER_SECOND) // show() deadlines
+#ifdef STREAM_LEDS
+// streaming mode: the frame is generated while it goes out, STREAM_LEDS can be far more than NUM_LEDS
+#if STREAM_IRQ_GAPS
+#define SHOW_US (STREAM_PIXEL_US + 50) // interrupts are only off while a pixel goes out
+#else
+#define SHOW_US (STREAM_LEDS * STREAM_PIXEL_US + 50)
+static_assert(STREAM_LEDS <= STREAM_MAX_LEDS, "interrupts would be off for longer than a Timer0 overflow, build with -DSTREAM_IRQ_GAPS=1");
+#endif
+#else
+#define SHOW_US (NUM_LEDS * 30 + 50) // FastLED.show() runs with interrupts off: 24 bits of 1.25 us per led, plus the latch
+#endif
+#ifndef PATTERN_SECONDS
+#define PATTERN_SECONDS 20 // time each pattern runs, the simavr bench shortens it
+#endif
 // CRGB leds[NUM_LEDS];
 CRGBArray<NUM_LEDS> leds;
 
-CRGBSet eyes(leds(4, 5));
-CRGBSet logo(leds(8, 9));
 
-void FillLEDsFromPaletteColors(CRGBPalette16 currentPalette, TBlendType currentBlending);
+Ticker frameTicker(FRAME_US); // FastLED.show() deadlines
+Ticker patternTicker(FRAME_MS * 1000UL);           // current pattern's update deadlines
+bool irAwareShow = true; // hold FastLED.show() back while it would delay an edge of an incoming ir frame
+IdleSleep idleSleep;
+bool sleepBetweenFrames = IDLE_SLEEP; // idle sleep instead of polling until the next deadline
+ClockScaler clockScaler;
+bool clockScaling = CLOCK_SCALING; // sleep on the slow clock, see clock.h
+bool hitLogging = HIT_LOG;         // damage packets into the eeprom, see hit_log.h
+HitCache hitCache;                 // one hit per trigger pull, and the tallies per team
 
-void rainbowColors();
-void partyColors();
-void oceanColors();
-void forestColors();
+template <typename Pixels>
+void FillLEDsFromPaletteColors(const TProgmemRGBPalette16 &palette, TBlendType blending);
 
-void christmasSparkles();
-void christmasSparklesRG();
-void christmasSparklesBP();
+void heart_beat_update(uint8_t hue, bool change_color);
+template <typename Lubs, typename Dubs>
+void heart_beat(uint8_t hue, bool change_color);
 
-void heart_beat_all();
-void heart_beat_all_reverse();
-void heart_beat_eyes_red();
-void heart_beat_eyes_blue();
-void heart_beat_eyes_mono();
-void heart_beat_logo();
+void handle_ir_packet(IrDataPacket packet);
+void render_hits();
 
-void heart_beat(CRGBSet lubs, CRGBSet dubs, uint8_t hue, bool change_color);
+void startTransition();
+void render_transition();
 
-void handle_ir_packet(IrDataPacket packet);
+void streamFrame();
+bool irActive();
+void serveHost();
 
+void startPattern(uint8_t number);
 void nextPattern();
 
 void setup()
@@ -52,67 +85,288 @@ void setup()
 
     FastLED.clear(true);
 
+    Data.init();
+    frameTicker.restart();
+    startPattern(0);
+#if HIT_LOG
+    hitLog.begin();
+#endif
+#if I2C_TARGET
+    i2cTarget.begin();
+#endif
+#if defined(IR_DEBUG_DUMP) && IR_HISTOGRAM
+    Data.startCapture();
+#endif
+
     // Enable global interrupts
     sei();
 }
 
 //---------------------------------------------------------------
-// List of patterns to cycle through.  Each is defined as a separate function.
-typedef void (*SimplePatternList[])();
-
-SimplePatternList gPatterns = 
+// List of patterns to cycle through.  Each is defined as a separate function,
+// called every update_ms, independent of the frame rate.
+// the table lives in flash, only the running entry is copied to ram.
+// the entries themselves are in patterns.h
+const Pattern gPatterns[] PROGMEM =
 {
-    rainbowColors,
-    heart_beat_eyes_red,
-    christmasSparkles,
-    partyColors,
-    heart_beat_all,
-    // oceanColors,
-    // forestColors,
-    // christmasSparklesRG,
-    // christmasSparklesBP,
-    // heart_beat_all_reverse,
-    // heart_beat_eyes_blue, 
-    // heart_beat_eyes_mono, 
-    // heart_beat_logo
+    PATTERN_ENTRY(rainbowColors),
+    PATTERN_ENTRY(heart_beat_eyes_red),
+    PATTERN_ENTRY(christmasSparkles),
+    PATTERN_ENTRY(partyColors),
+    PATTERN_ENTRY(heart_beat_all),
+#if BAKED_ANIMATION && defined(BAKED_STREAM_H)
+    PATTERN_ENTRY(bakedAnimation), // heart_beat_eyes_blue, baked
+#endif
+    // PATTERN_ENTRY(oceanColors),
+    // PATTERN_ENTRY(forestColors),
+    // PATTERN_ENTRY(paletteMorph),
+    // PATTERN_ENTRY(christmasSparklesRG),
+    // PATTERN_ENTRY(christmasSparklesBP),
+    // PATTERN_ENTRY(heart_beat_all_reverse),
+    // PATTERN_ENTRY(heart_beat_eyes_blue),
+    // PATTERN_ENTRY(heart_beat_eyes_mono),
+    // PATTERN_ENTRY(heart_beat_logo),
 };
+const uint8_t gPatternCount = sizeof(gPatterns) / sizeof(gPatterns[0]);
+
+bool patternPainted = false; // the pattern rendered since the last frame went out
 
 uint8_t gCurrentPatternNumber = 0; // Index number of which pattern is current
+Pattern gCurrentPattern;           // its gPatterns entry
+PatternState patternState;         // shared by all patterns, see patterns.h
+#ifdef STREAM_LEDS
+uint8_t gStreamPattern = 0;        // generator streamFrame() runs, advanced with the patterns
+#endif
 
 //---------------------------------------------------------------
+// an ir edge came in within the longest start pulse: a frame may be on the air.
+// loop() runs after every edge (the edge ends the idle sleep), close enough to time them here
+bool irActive()
+{
+    static uint8_t edgesSeen;
+    static uint32_t edgeAt;
+    uint8_t edges = Data.getPinChangeCount();
+    if (edges != edgesSeen)
+    {
+        edgesSeen = edges;
+        edgeAt = micros();
+    }
+    return micros() - edgeAt < ir_start_max_us;
+}
+
 void loop()
 {
+    // 8 MHz for the leds and from the first edge of an ir frame on, the slow clock is only for sleeping
+    bool ir_active = irActive();
+    if (clockScaler.isSlow() && (ir_active || frameTicker.due()
+#ifndef STREAM_LEDS
+                                 || patternTicker.due()
+#endif
+                                 ))
+        clockScaler.fast();
+
     // light effect when receiving blaster shot
-    handle_ir_packet(Data.readIr());
+    IrDataPacket packets[IR_QUEUE_SIZE];
+    BENCH_MARK_BEGIN(eMarkReadIr);
+    uint8_t received = Data.readIr(packets);
+    BENCH_MARK_END(eMarkReadIr);
+    for (uint8_t i = 0; i < received; i++)
+    {
+#if I2C_TARGET
+        i2cTarget.push(packets[i]);
+#endif
+        BENCH_MARK_BEGIN(eMarkHit);
+        handle_ir_packet(packets[i]);
+        BENCH_MARK_END(eMarkHit);
+    }
+
+#ifdef STREAM_LEDS
+    // the frame streams straight from a generator, nothing to render ahead
+    if (frameTicker.due() && (!irAwareShow || Data.canShow(SHOW_US)))
+    {
+        frameTicker.next();
+        BENCH_MARK_BEGIN(eMarkStream);
+        streamFrame();
+        BENCH_MARK_END(eMarkStream);
+    }
+#else
+    // Call the current pattern function when its update is due, updating the 'leds' array
+    if (patternTicker.due())
+    {
+        patternTicker.next();
+        BENCH_MARK_BEGIN(eMarkPattern + gCurrentPatternNumber);
+        gCurrentPattern.render();
+        BENCH_MARK_END(eMarkPattern + gCurrentPatternNumber);
+        patternPainted = true;
+    }
+
+    // the frame goes out on its own deadline, not after a fixed delay,
+    // the time in between stays free for the ir interrupt.
+    // while a frame is on the air the show waits for the gap after a bit edge,
+    // an edge during show() would get a late timestamp and fall outside its window
+    if (frameTicker.due() && (!irAwareShow || Data.canShow(SHOW_US)))
+    {
+        frameTicker.next();
+
+        // crossfade from the previous pattern, then blend running hit effects on top
+        BENCH_MARK_BEGIN(eMarkTransition);
+        render_transition();
+        BENCH_MARK_END(eMarkTransition);
+        render_hits();
+        patternPainted = false;
 
-    // Call the current pattern function once, updating the 'leds' array
-    gPatterns[gCurrentPatternNumber]();
-    
-    FastLED.show();
-    // slows the framerate to a modest value
-    delay(1000 / FRAMES_PER_SECOND);  // use delay, to give some time to process ir interrupts
-    // FastLED.delay(1000 / FRAMES_PER_SECOND); 
+        BENCH_MARK_BEGIN(eMarkShow);
+        FastLED.show();
+        BENCH_MARK_END(eMarkShow);
+    }
+#endif
 
     // do some periodic updates
-    EVERY_N_SECONDS(20)
+    EVERY_N_SECONDS(PATTERN_SECONDS)
     {
+        startTransition();
         nextPattern();
         FastLED.clear();
+        patternPainted = true; // black until the new pattern's first update, faded in from the old frame
     } // change patterns periodically
+
+#if HIT_CACHE
+    EVERY_N_SECONDS(HIT_CACHE_SWEEP_SECONDS)
+    {
+        hitCache.expire(millis());
+    }
+#endif
+
+#ifdef IR_DEBUG_DUMP
+    // the uart counts 8 MHz cycles, and keeps interrupts off a byte at a time: not while a frame comes in
+    static bool dump_due = false;
+    EVERY_N_SECONDS(DEBUG_DUMP_SECONDS)
+    {
+        dump_due = true;
+    }
+    if (dump_due && !irActive())
+    {
+        clockScaler.fast();
+        debugDump();
+        dump_due = false;
+    }
+#endif
+
+#if I2C_TARGET
+    serveHost();
+#endif
+
+    // nothing due before the next deadline: sleep until then, an ir edge wakes it earlier.
+    // a frame held back for an ir frame on the air goes out after the next edge
+    if (sleepBetweenFrames)
+    {
+        uint32_t idle_us = frameTicker.untilDue();
+        if (frameTicker.due())
+        {
+            // held back: until the ir frame is through, no longer than a frame period in case it never is
+            idle_us = Data.remainingAirtime();
+            if (idle_us > FRAME_US)
+                idle_us = FRAME_US;
+        }
+#ifndef STREAM_LEDS
+        uint32_t pattern_us = patternTicker.untilDue();
+        if (pattern_us < idle_us)
+            idle_us = pattern_us;
+#endif
+        // the first edge of a frame wakes the slow clock, loop() then goes back to 8 MHz for the rest
+        if (clockScaling && !ir_active)
+            clockScaler.slow();
+        idleSleep.sleep(idle_us);
+    }
 }
 
 //---------------------------------------------------------------
-#define ARRAY_SIZE(A) (sizeof(A) / sizeof((A)[0]))
+// the host on i2c: its commands, the USI ISRs only took them in, and the status it reads
+#if I2C_TARGET
+void serveHost()
+{
+    uint8_t value;
+    if (i2cTarget.takePattern(value) && value < gPatternCount)
+    {
+        startTransition();
+        startPattern(value);
+        FastLED.clear();
+        patternPainted = true;
+    }
+    if (i2cTarget.takeBrightness(value))
+        FastLED.setBrightness(value);
+
+    I2cStatus status;
+    status.pattern = gCurrentPatternNumber;
+    status.brightness = FastLED.getBrightness();
+    status.overflows = Data.getOverflowCount();
+    status.received = Data.getReceivedCount();
+    status.duplicates = Data.getDuplicateCount();
+#if HIT_CACHE
+    const uint8_t teams[] = {eTeamRex, eTeamGiggle, eTeamBuzz};
+    for (uint8_t i = 0; i < 3; i++)
+        status.tallies[i] = hitCache.getTally(teams[i]);
+#else
+    memset(status.tallies, 0, sizeof(status.tallies));
+#endif
+    i2cTarget.update(status);
+}
+#endif
+
+//---------------------------------------------------------------
+void initPatternState(const Pattern &pattern)
+{
+    memset(&patternState, 0, sizeof(patternState));
+    if (pattern.init)
+        pattern.init();
+}
+
+void startPattern(uint8_t number)
+{
+    gCurrentPatternNumber = number;
+    memcpy_P(&gCurrentPattern, &gPatterns[number], sizeof(gCurrentPattern));
+    initPatternState(gCurrentPattern);
+    patternTicker.setPeriod(gCurrentPattern.update_ms * 1000UL);
+}
+
 void nextPattern()
 {
     // add one to the current pattern number, and wrap around at the end
-    gCurrentPatternNumber = (gCurrentPatternNumber + 1) % ARRAY_SIZE(gPatterns);
+    startPattern((gCurrentPatternNumber + 1) % gPatternCount);
+#ifdef STREAM_LEDS
+    gStreamPattern++;
+#endif
 }
 
+//---------------------------------------------------------------
+// Hit effects: a flash in the team color that fades out over the running pattern.
+// handle_ir_packet only starts a flash, render_hits blends them in every frame,
+// so loop() keeps its frame rate and hits from different teams stack.
+#define HIT_SLOTS 3 // flashes that can run at the same time
+#define HIT_FADE 10 // per frame, how fast a flash fades out
+
+struct HitEffect
+{
+    CRGB color;
+    uint8_t level; // blend amount over the pattern, 0 = slot free
+};
+HitEffect hits[HIT_SLOTS];
+
 void handle_ir_packet(IrDataPacket packet)
 {
     if (packet.get_raw() != 0 && packet.get_action() == eActionDamage)
     {
+#if HIT_CACHE
+        BENCH_MARK_BEGIN(eMarkHitCache);
+        bool repeat = !hitCache.accept(packet, millis());
+        BENCH_MARK_END(eMarkHitCache);
+        if (repeat)
+            return; // the same shot again: its flash is running already
+#endif
+#if HIT_LOG
+        if (hitLogging)
+            hitLog.log(packet); // only queued, the eeprom is written in the background
+#endif
         CRGB color = CRGB::Black;
 
         switch (packet.get_team())
@@ -150,298 +404,420 @@ void handle_ir_packet(IrDataPacket packet)
             break;
         }
 
-        leds = color;
-        FastLED.show();
+        if (!color)
+            return;
 
-        while (leds[0].getAverageLight() != 0)
+        // same team hits again: restart its flash, else take a free slot or the faintest one
+        uint8_t slot = 0;
+        for (uint8_t i = 0; i < HIT_SLOTS; i++)
         {
-            delay(1000/FRAMES_PER_SECOND);
-            leds.fadeToBlackBy(10);
-            FastLED.show();
+            if (hits[i].color == color)
+            {
+                slot = i;
+                break;
+            }
+            if (hits[i].level < hits[slot].level)
+                slot = i;
         }
-        delay(100);
-        Data.readIr(); // clear buffer
-        FastLED.clear();
+        hits[slot].color = color;
+        hits[slot].level = 255;
     }
 }
 
-void FillLEDsFromPaletteColors(CRGBPalette16 currentPalette, TBlendType currentBlending)
-{
-
-    static uint8_t startIndex = 0;
-    startIndex = startIndex + 1; /* motion speed */
+//---------------------------------------------------------------
+// Transitions: the last frame of the old pattern crossfades into the new one
+// over TRANSITION_FRAMES frames. the old frame is kept packed at 16 bit per led,
+// there is no second 'leds': the blend goes in place like the hits, only on
+// frames the pattern repainted, a frame without a repaint still holds the last blend.
+#define TRANSITION_FRAMES 32 // about half a second
+#define TRANSITION_STEP ((255 + TRANSITION_FRAMES - 1) / TRANSITION_FRAMES)
 
-    uint8_t index = startIndex;
+uint16_t transitionFrom[NUM_LEDS]; // old frame, rgb565
+uint8_t transitionLevel = 255;     // how far the new pattern is in, 255 = done
 
-    for (uint8_t i = 0; i < NUM_LEDS; ++i)
+void startTransition()
+{
+    for (uint8_t i = 0; i < NUM_LEDS; i++)
     {
-        leds[i] = ColorFromPalette(currentPalette, index, BRIGHTNESS, currentBlending);
-        index += 3;
+        transitionFrom[i] = ((leds[i].r & 0xF8) << 8) | ((leds[i].g & 0xFC) << 3) | (leds[i].b >> 3);
     }
+    transitionLevel = 0;
 }
 
-void rainbowColors() { FillLEDsFromPaletteColors(RainbowColors_p, LINEARBLEND); }
-void partyColors()   { FillLEDsFromPaletteColors(PartyColors_p,   LINEARBLEND); }
-void oceanColors()   { FillLEDsFromPaletteColors(OceanColors_p,   LINEARBLEND); }
-void forestColors()  { FillLEDsFromPaletteColors(ForestColors_p,  LINEARBLEND); }
-
+void render_transition()
+{
+    if (transitionLevel == 255)
+        return;
+    transitionLevel = qadd8(transitionLevel, TRANSITION_STEP);
+    if (!patternPainted)
+        return;
 
+    for (uint8_t i = 0; i < NUM_LEDS; i++)
+    {
+        uint16_t from = transitionFrom[i];
+        nblend(leds[i], CRGB((from >> 8) & 0xF8, (from >> 3) & 0xFC, from << 3), 255 - transitionLevel);
+    }
+}
 
-//===============================================================
-// The different patterns to choose from...
-//===============================================================
+#ifdef STREAM_LEDS
 //---------------------------------------------------------------
-uint8_t ledsData[NUM_LEDS][4];    // for Sparkles, array to store RGB data and an extra value
-uint8_t pick;                     // for Sparkles, stores a temporary pixel number
+// Streaming mode (-DSTREAM_LEDS=n): no pattern renders into 'leds', the frame is
+// generated pixel by pixel while it goes out (stream_show.h). the hit flash is
+// the strongest slot only, one nblend per pixel fits between two pixels.
+template <typename Generator>
+struct WithHit
+{
+    const Generator &generator;
+    const HitEffect &hit;
 
-void christmasSparkles()
+    CRGB color_at(uint16_t index, uint16_t time) const
+    {
+        CRGB color = generator.color_at(index, time);
+        if (hit.level)
+            nblend(color, hit.color, hit.level);
+        return color;
+    }
+};
+
+template <typename Generator>
+void streamWithHit(const Generator &generator, uint16_t time)
 {
-    //"Background" color for non-sparkling pixels.
-    CRGB sparkleBgColor = CHSV(50, 30, 40); // dim white
-    // CRGB sparkleBgColor = CHSV(96, 200, 30);  // dim green
+    uint8_t strongest = 0;
+    for (uint8_t h = 1; h < HIT_SLOTS; h++)
+    {
+        if (hits[h].level > hits[strongest].level)
+            strongest = h;
+    }
+    streamShow(WithHit<Generator>{generator, hits[strongest]}, STREAM_LEDS, time, BRIGHTNESS);
+}
 
-    EVERY_N_MILLISECONDS(40)
+void streamFrame()
+{
+    uint16_t time = frameTicker.getTicks();
+    switch (gStreamPattern % 3)
     {
-        if (random8() < 60)
-        { // How much to sparkle!  Higher number is more.
-            pick = random8(NUM_LEDS);
-            if (ledsData[pick][3] == 0)
-            {
-                ledsData[pick][3] = 35; // Used to tag pixel as sparkling
-                uint8_t randomPick = random8(5);
-                if (randomPick == 0)
-                {
-                    ledsData[pick][0] = 178; // sparkle hue (blue)
-                    ledsData[pick][1] = 244; // sparkle saturation
-                    ledsData[pick][2] = 210; // sparkle value
-                }
-                if (randomPick == 1)
-                {
-                    ledsData[pick][0] = 10;  // sparkle hue (red)
-                    ledsData[pick][1] = 255; // sparkle saturation
-                    ledsData[pick][2] = 240; // sparkle value
-                }
-                if (randomPick == 2)
-                {
-                    ledsData[pick][0] = 0;   // sparkle hue (white-ish)
-                    ledsData[pick][1] = 25;  // sparkle saturation
-                    ledsData[pick][2] = 255; // sparkle value
-                }
-                if (randomPick == 3)
-                {
-                    ledsData[pick][0] = 35;  // sparkle hue (orange)
-                    ledsData[pick][1] = 235; // sparkle saturation
-                    ledsData[pick][2] = 245; // sparkle value
-                }
-                if (randomPick == 4)
-                {
-                    ledsData[pick][0] = 190; // sparkle hue (purple)
-                    ledsData[pick][1] = 255; // sparkle saturation
-                    ledsData[pick][2] = 238; // sparkle value
-                }
-                leds[pick] = CHSV(ledsData[pick][0], ledsData[pick][1], ledsData[pick][2]);
-            }
-        }
-        for (uint8_t i = 0; i < NUM_LEDS; i++)
+    case 0:
+        streamWithHit(PaletteStream(RainbowColors_p), time);
+        break;
+    case 1:
+        streamWithHit(HatStream(), time);
+        break;
+    default:
+        streamWithHit(PaletteStream(PartyColors_p), time);
+        break;
+    }
+
+    for (uint8_t h = 0; h < HIT_SLOTS; h++)
+    {
+        hits[h].level = scale8(hits[h].level, 255 - HIT_FADE);
+    }
+}
+#endif
+
+void render_hits()
+{
+    for (uint8_t h = 0; h < HIT_SLOTS; h++)
+    {
+        if (hits[h].level == 0)
+            continue;
+        // a frame the pattern didn't repaint has the flash in it already, blend it again and it compounds
+        if (patternPainted)
         {
-            if (ledsData[i][3] == 0)
-            { // if not sparkling, set to "back ground" color
-                leds[i] = sparkleBgColor;
-            }
-            else
+            for (uint8_t i = 0; i < NUM_LEDS; i++)
             {
-                CHSV hsv = rgb2hsv_approximate(leds[i]);                   // Used to get approximate Hue
-                EVERY_N_MILLISECONDS(38) { ledsData[i][0] = hsv.hue - 1; } // slightly shift hue
-                ledsData[i][2] = scale8(ledsData[i][2], 245);              // slowly darken
-                leds[i] = CHSV(ledsData[i][0], ledsData[i][1], ledsData[i][2]);
-                ledsData[i][3] = ledsData[i][3] - 1; // countdown sparkle tag
+                nblend(leds[i], hits[h].color, hits[h].level);
             }
         }
+        hits[h].level = scale8(hits[h].level, 255 - HIT_FADE);
     }
-} // end christmasSparkles
+}
+
+// samples the palette straight from flash, no CRGBPalette16 copy in ram or on the stack
+template <typename Pixels>
+void FillLEDsFromPaletteColors(const TProgmemRGBPalette16 &palette, TBlendType blending)
+{
+    uint8_t &startIndex = patternState.palette.startIndex;
+    startIndex = startIndex + 1; /* motion speed */
+
+    uint8_t start = startIndex;
+
+    Pixels::each([&](uint16_t pixel, uint16_t position) {
+        leds[pixel] = ColorFromPalette(palette, start + position * 3, BRIGHTNESS, blending);
+    });
+}
+
+void rainbowColors() { FillLEDsFromPaletteColors<Layout::All>(RainbowColors_p, LINEARBLEND); }
+void partyColors()   { FillLEDsFromPaletteColors<Layout::All>(PartyColors_p,   LINEARBLEND); }
+void oceanColors()   { FillLEDsFromPaletteColors<Layout::All>(OceanColors_p,   LINEARBLEND); }
+void forestColors()  { FillLEDsFromPaletteColors<Layout::All>(ForestColors_p,  LINEARBLEND); }
 
 //---------------------------------------------------------------
-void christmasSparklesRG()
-{ // Red and Green only
-    //"Background" color for non-sparkling pixels.  Can be set to black for no bg color.
-    CRGB sparkleBgColor = CHSV(0, 0, 0); // black
-    // CRGB sparkleBgColor = CHSV(50, 30, 30);  // dim white
-
-    EVERY_N_MILLISECONDS(40)
-    {
-        if (random8() < 110)
-        { // How much to sparkle!  Higher number is more.
-            pick = random8(NUM_LEDS);
-            if (ledsData[pick][3] == 0)
-            {
-                ledsData[pick][3] = 65; // Used to tag pixel as sparkling
-                uint8_t randomPick = random8(2);
-                if (randomPick == 0)
-                {
-                    ledsData[pick][0] = 16;  // sparkle hue (red)
-                    ledsData[pick][1] = 253; // sparkle saturation
-                    ledsData[pick][2] = 242; // sparkle value
-                }
-                if (randomPick == 1)
-                {
-                    ledsData[pick][0] = 96;  // sparkle hue (green)
-                    ledsData[pick][1] = 230; // sparkle saturation
-                    ledsData[pick][2] = 255; // sparkle value
-                }
-                leds[pick] = CHSV(ledsData[pick][0], ledsData[pick][1], ledsData[pick][2]);
-            }
-        }
-        for (uint8_t i = 0; i < NUM_LEDS; i++)
+// Palette morph: scrolls like the palettes above, holds each one of morphPalettes
+// for MORPH_HOLD updates, then blends into the next over 255 / MORPH_STEP updates.
+// both palettes are sampled from flash and blended per pixel, like
+// nblendPaletteTowardPalette but without the two 48 byte palettes in ram.
+#define MORPH_HOLD 250 // updates, 4 s at FRAME_MS
+#define MORPH_STEP 2   // blend per update, 2 s from one palette to the next
+
+const TProgmemRGBPalette16 *const morphPalettes[] PROGMEM =
+{
+    &RainbowColors_p,
+    &PartyColors_p,
+    &OceanColors_p,
+    &ForestColors_p,
+};
+#define MORPH_PALETTES (sizeof(morphPalettes) / sizeof(morphPalettes[0]))
+
+void paletteMorph()
+{
+    PaletteMorphState &state = patternState.paletteMorph;
+    if (state.hold)
+    {
+        state.hold--;
+    }
+    else
+    {
+        state.amount = qadd8(state.amount, MORPH_STEP);
+        if (state.amount == 255)
         {
-            if (ledsData[i][3] == 0)
-            { // if not sparkling, set to "back ground" color
-                leds[i] = sparkleBgColor;
-            }
-            else
-            {
-                CHSV hsv = rgb2hsv_approximate(leds[i]);                   // Used to get approximate Hue
-                EVERY_N_MILLISECONDS(50) { ledsData[i][0] = hsv.hue - 1; } // slightly shift hue
-                ledsData[i][2] = scale8(ledsData[i][2], 253);              // slowly darken
-                leds[i] = CHSV(ledsData[i][0], ledsData[i][1], ledsData[i][2]);
-                ledsData[i][3] = ledsData[i][3] - 1; // countdown sparkle tag
-            }
+            state.from = (state.from + 1) % MORPH_PALETTES;
+            state.amount = 0;
+            state.hold = MORPH_HOLD;
         }
     }
-} // end christmasSparklesRG
 
+    const TProgmemRGBPalette16 &from = *(const TProgmemRGBPalette16 *)pgm_read_ptr(&morphPalettes[state.from]);
+    const TProgmemRGBPalette16 &to = *(const TProgmemRGBPalette16 *)pgm_read_ptr(&morphPalettes[(state.from + 1) % MORPH_PALETTES]);
+
+    state.startIndex = state.startIndex + 1; /* motion speed */
+    uint8_t start = state.startIndex;
+    uint8_t amount = state.amount;
+    Layout::All::each([&](uint16_t pixel, uint16_t position) {
+        uint8_t index = start + position * 3;
+        leds[pixel] = ColorFromPalette(from, index, BRIGHTNESS, LINEARBLEND);
+        if (amount)
+            nblend(leds[pixel], ColorFromPalette(to, index, BRIGHTNESS, LINEARBLEND), amount);
+    });
+}
+
+
+
+//===============================================================
+// The different patterns to choose from...
+//===============================================================
 //---------------------------------------------------------------
-void christmasSparklesBP()
-{ // Blues and Purple only
-    //"Background" color for non-sparkling pixels.
-    CRGB sparkleBgColor = CHSV(96, 185, 30); // green
+// Baked animation: plays the frames tools/bake recorded from one of the patterns
+// on the host (include/baked_stream.h), a few flash reads per pixel and no state
+// but the position, so any pattern that is too heavy to run live can be baked.
+// tools/bake/bake.py bakes for a Layout given to it, a stream baked for another
+// one is cut off or padded with black.
+#ifdef BAKED_STREAM_H
+static_assert(BAKED_FRAME_MS == FRAME_MS, "bakedAnimation plays at FRAME_MS, bake include/baked_stream.h again");
+
+void bakedAnimation()
+{
+    uint16_t &offset = patternState.baked.offset;
+    for (uint16_t i = 0; i < BAKED_LEDS;)
+    {
+        uint8_t count = pgm_read_byte(&bakedRuns[offset++]);
+        const uint8_t *color = bakedColors[pgm_read_byte(&bakedRuns[offset++])];
+        CRGB rgb(pgm_read_byte(color), pgm_read_byte(color + 1), pgm_read_byte(color + 2));
+        for (; count; count--, i++)
+            if (i < NUM_LEDS)
+                leds[i] = rgb;
+    }
+    for (uint16_t i = BAKED_LEDS; i < NUM_LEDS; i++)
+        leds[i] = CRGB::Black;
+    if (offset == sizeof(bakedRuns))
+        offset = 0; // loop
+}
+#endif
 
-    EVERY_N_MILLISECONDS(40)
+//---------------------------------------------------------------
+// Sparkles: random pixels light up in one of a few colors over a dim background,
+// then drift in hue and darken until their lifetime runs out.
+// every variant is a row in sparkleStyles, the engine steps once per update_ms.
+#define SPARKLE_COLORS 5 // max colors per style
+
+struct SparkleColor
+{
+    uint8_t hue, sat, val;
+};
+
+struct SparkleStyle
+{
+    SparkleColor background; // for non-sparkling pixels, black for none
+    uint8_t chance;          // per step, out of 256: how much to sparkle, higher number is more
+    uint8_t lifetime;        // steps a sparkle lasts
+    uint8_t decay;           // value scale per step, slowly darken
+    uint8_t hue_drift;       // hue shift per step
+    uint8_t colors;          // used entries of color
+    SparkleColor color[SPARKLE_COLORS];
+};
+
+enum SparkleStyleId : uint8_t
+{
+    eSparklesChristmas,
+    eSparklesRG,
+    eSparklesBP,
+};
+
+const SparkleStyle sparkleStyles[] PROGMEM =
+{
+    // eSparklesChristmas, dim white background
+    {{50, 30, 40}, 60, 35, 245, 1, 5, {
+        {178, 244, 210}, // blue
+        {10, 255, 240},  // red
+        {0, 25, 255},    // white-ish
+        {35, 235, 245},  // orange
+        {190, 255, 238}, // purple
+    }},
+    // eSparklesRG, red and green only on black
+    {{0, 0, 0}, 110, 65, 253, 1, 2, {
+        {16, 253, 242}, // red
+        {96, 230, 255}, // green
+    }},
+    // eSparklesBP, blues and purple only on green
+    {{96, 185, 30}, 170, 20, 242, 2, 3, {
+        {165, 180, 230}, // blue
+        {200, 170, 240}, // pink-light-purple
+        {130, 200, 255}, // light blue
+    }},
+};
+
+void sparkles(SparkleStyleId id)
+{
+    SparkleState &state = patternState.sparkle;
+    SparkleStyle style;
+    memcpy_P(&style, &sparkleStyles[id], sizeof(style));
+
+    if (random8() < style.chance)
     {
-        if (random8() < 170)
-        { // How much to sparkle!  Higher number is more.
-            pick = random8(NUM_LEDS);
-            if (ledsData[pick][3] == 0)
-            {
-                ledsData[pick][3] = 20; // Used to tag pixel as sparkling
-                uint8_t randomPick = random8(3);
-                if (randomPick == 0)
-                {
-                    ledsData[pick][0] = 165; // sparkle hue (blue)
-                    ledsData[pick][1] = 180; // sparkle saturation
-                    ledsData[pick][2] = 230; // sparkle value
-                }
-                if (randomPick == 1)
-                {
-                    ledsData[pick][0] = 200; // sparkle hue (pink-light-purple)
-                    ledsData[pick][1] = 170; // sparkle saturation
-                    ledsData[pick][2] = 240; // sparkle value
-                }
-                if (randomPick == 2)
-                {
-                    ledsData[pick][0] = 130; // sparkle hue (light blue)
-                    ledsData[pick][1] = 200; // sparkle saturation
-                    ledsData[pick][2] = 255; // sparkle value
-                }
-                leds[pick] = CHSV(ledsData[pick][0], ledsData[pick][1], ledsData[pick][2]);
-            }
+        uint8_t pick = random8(NUM_LEDS);
+        if (state.life[pick] == 0)
+        {
+            const SparkleColor &color = style.color[random8(style.colors)];
+            state.life[pick] = style.lifetime;
+            state.hue[pick] = color.hue;
+            state.sat[pick] = color.sat;
+            state.val[pick] = color.val;
         }
-        for (uint8_t i = 0; i < NUM_LEDS; i++)
+    }
+
+    CRGB background = CHSV(style.background.hue, style.background.sat, style.background.val);
+    for (uint8_t i = 0; i < NUM_LEDS; i++)
+    {
+        if (state.life[i] == 0)
         {
-            if (ledsData[i][3] == 0)
-            { // if not sparkling, set to "back ground" color
-                leds[i] = sparkleBgColor;
-            }
-            else
-            {
-                CHSV hsv = rgb2hsv_approximate(leds[i]);                   // Used to get approximate Hue
-                EVERY_N_MILLISECONDS(20) { ledsData[i][0] = hsv.hue - 1; } // slightly shift hue
-                ledsData[i][2] = scale8(ledsData[i][2], 242);              // slowly darken
-                leds[i] = CHSV(ledsData[i][0], ledsData[i][1], ledsData[i][2]);
-                ledsData[i][3] = ledsData[i][3] - 1; // countdown sparkle tag
-            }
+            leds[i] = background;
+            continue;
         }
+        state.hue[i] -= style.hue_drift;
+        state.val[i] = scale8(state.val[i], style.decay);
+        leds[i] = CHSV(state.hue[i], state.sat[i], state.val[i]);
+        state.life[i]--;
     }
-} // end christmasSparklesBP
+}
 
-void heart_beat_all()         { heart_beat(leds(0, 4), leds(5, 9), HUE_RED , true) ; }
-void heart_beat_all_reverse() { heart_beat(leds(9, 5), leds(4, 0), HUE_RED , true ); }
-void heart_beat_eyes_red()    { heart_beat(leds(4, 4), leds(5, 5), HUE_RED , false); }
-void heart_beat_eyes_blue()   { heart_beat(leds(4, 4), leds(5, 5), HUE_BLUE, false); }
-void heart_beat_eyes_mono()   { heart_beat(leds(4, 5), leds(4, 5), HUE_RED , false); }
-void heart_beat_logo()        { heart_beat(leds(8, 8), leds(9, 9), HUE_RED , true ); }
+void christmasSparkles()   { sparkles(eSparklesChristmas); }
+void christmasSparklesRG() { sparkles(eSparklesRG); }        // Red and Green only
+void christmasSparklesBP() { sparkles(eSparklesBP); }        // Blues and Purple only
+
+void heart_beat_all()         { heart_beat<Layout::FirstHalf, Layout::SecondHalf>(HUE_RED , true ); }
+void heart_beat_all_reverse() { heart_beat<Reversed<Layout::SecondHalf>, Reversed<Layout::FirstHalf>>(HUE_RED , true ); }
+void heart_beat_eyes_red()    { heart_beat<Layout::LeftEye, Layout::RightEye>(HUE_RED , false); }
+void heart_beat_eyes_blue()   { heart_beat<Layout::LeftEye, Layout::RightEye>(HUE_BLUE, false); }
+void heart_beat_eyes_mono()   { heart_beat<Layout::Eyes, Layout::Eyes>(HUE_RED , false); }
+void heart_beat_logo()        { heart_beat<Layout::LogoLeft, Layout::LogoRight>(HUE_RED , true ); }
 
 //---------------------------------------------------------------
 // Heart beat function
 #define LUB_TIME 1100 // Time between main lubs [milliseconds]
 #define DUB_DELAY 120 // Short delay for when secondary dub starts [milliseconds]
 
-void heart_beat(CRGBSet lubs, CRGBSet dubs, uint8_t hue, bool change_color)
+// EVERY_N_MILLISECONDS on a deadline in the pattern state
+static bool every(uint16_t &at, uint16_t period_ms)
 {
+    uint16_t now = millis();
+    if ((int16_t)(now - at) < 0)
+        return false;
+    at = now + period_ms;
+    return true;
+}
+
+void heart_beat_init()
+{
+    HeartBeatState &state = patternState.heartBeat;
+    uint16_t now = millis();
+    state.fadeAt = now + 5;
+    state.lubAt = now + LUB_TIME;
+    state.lubRampAt = now + 7;
+    state.dubRampAt = now + 7;
+    state.hueAt = now + DUB_DELAY;
+    state.hue = HUE_RED;
+}
 
-    static boolean lubRunning = 0;                  // Is lub running? [1=true/0=false]
-    static boolean dubRunning = 0;                  // Is dub running? [1=true/0=false]
-    static boolean dubTrigger = 0;                  // Is dub triggered? [1=true/0=false]
-    static CEveryNMilliseconds dubTimer(DUB_DELAY); // Create timer for dub delay
-    static uint8_t lubValue, dubValue;
-    static uint8_t heart_hue = HUE_RED;
+// the timing and levels, the same for every heart_beat<> whatever pixels it paints
+void heart_beat_update(uint8_t hue, bool change_color)
+{
+    HeartBeatState &state = patternState.heartBeat;
     if (!change_color)
     {
-        heart_hue = hue;
+        state.hue = hue;
     }
 
-    // CRGBSet lubs(leds(4, 4)); // Pixels for lub (first) part of heart beat
-    // CRGBSet dubs(leds(5, 5)); // Pixels for dub (second) part of heart beat
-
     //---------------------------------
     // Regularly fade out the heart beat pixels
-    EVERY_N_MILLISECONDS(5)
-    {                           // How often to do the fade
-        lubs.fadeToBlackBy(21); // Amount to fade [use smaller number for slower fade]
-        dubs.fadeToBlackBy(18);
+    if (every(state.fadeAt, 5))
+    {                                                     // How often to do the fade
+        state.lubLevel = scale8(state.lubLevel, 255 - 21); // Amount to fade [use smaller number for slower fade]
+        state.dubLevel = scale8(state.dubLevel, 255 - 18);
     }
 
     //---------------------------------
     // Timing of heart beat
-    EVERY_N_MILLISECONDS(LUB_TIME)
+    if (every(state.lubAt, LUB_TIME))
     {
-        lubRunning = 1;
-        lubValue = 20; // Starting value when ramping up [Use 1 or greater]
-        dubTrigger = 1;
-        dubTimer.reset(); // Reset dub timer
+        state.lubRunning = 1;
+        state.lubValue = 20; // Starting value when ramping up [Use 1 or greater]
+        state.dubTrigger = 1;
+        state.dubAt = millis() + DUB_DELAY; // Reset dub timer
     }
-    if (dubTrigger && dubTimer)
+    if (state.dubTrigger && every(state.dubAt, DUB_DELAY))
     {
-        dubRunning = 1;
-        dubValue = 1;   // Starting value when ramping up [Use 1 or greater]
-        dubTrigger = 0; // Reset trigger
+        state.dubRunning = 1;
+        state.dubValue = 1;   // Starting value when ramping up [Use 1 or greater]
+        state.dubTrigger = 0; // Reset trigger
     }
 
     //---------------------------------
     // Assign pixel data
-    if (lubRunning)
+    if (state.lubRunning)
     {
-        EVERY_N_MILLISECONDS(7)
+        if (every(state.lubRampAt, 7))
         {
-            lubValue = brighten8_video(lubValue);
+            state.lubValue = brighten8_video(state.lubValue);
         }
-        lubs = CHSV(heart_hue, 255, lubValue);
-        if (lubValue >= 250)
+        state.lubHue = state.hue;
+        state.lubLevel = state.lubValue;
+        if (state.lubValue >= 250)
         {
-            lubRunning = 0; // Reset
+            state.lubRunning = 0; // Reset
         }
     }
 
-    if (dubRunning)
+    if (state.dubRunning)
     {
-        EVERY_N_MILLISECONDS(7)
+        if (every(state.dubRampAt, 7))
         {
-            dubValue = brighten8_video(dubValue);
+            state.dubValue = brighten8_video(state.dubValue);
         }
 
-        dubs = CHSV(heart_hue, 255, dubValue);
-        if (dubValue >= 250)
+        state.dubHue = state.hue;
+        state.dubLevel = state.dubValue;
+        if (state.dubValue >= 250)
         {
-            dubRunning = 0; // Reset
+            state.dubRunning = 0; // Reset
         }
     }
 
@@ -449,12 +825,35 @@ void heart_beat(CRGBSet lubs, CRGBSet dubs, uint8_t hue, bool change_color)
     // Just for fun... Uncomment for rainbow heart beats!
     if (change_color)
     {
-        EVERY_N_MILLISECONDS(DUB_DELAY)
+        if (every(state.hueAt, DUB_DELAY))
         {
-            heart_hue = heart_hue + random8(32, 65);
+            state.hue = state.hue + random8(32, 65);
         }
     }
+}
+
+// Lubs and Dubs are the pixels of the lub (first) and dub (second) part, segments of Layout
+template <typename Lubs, typename Dubs>
+void heart_beat(uint8_t hue, bool change_color)
+{
+    HeartBeatState &state = patternState.heartBeat;
+    heart_beat_update(hue, change_color);
 
+    //---------------------------------
+    // paint the whole strip, where lub and dub share pixels the brighter one shows
+    CRGB lub = CHSV(state.lubHue, 255, state.lubLevel);
+    CRGB dub = CHSV(state.dubHue, 255, state.dubLevel);
+    leds = CRGB::Black;
+    if (state.lubLevel > state.dubLevel)
+    {
+        Dubs::fill(leds, dub);
+        Lubs::fill(leds, lub);
+    }
+    else
+    {
+        Lubs::fill(leds, lub);
+        Dubs::fill(leds, dub);
+    }
 } // end heart_beat
 
 //---------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,135 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+#include <Arduino.h>
+#include <FastLED.h>
+#include "layout.h"
+
+#define NUM_LEDS (Layout::num_leds)
+#define FRAMES_PER_SECOND 60
+#define FRAME_MS (1000 / FRAMES_PER_SECOND) // pattern update rate that matches the old fixed delay
+#define SPARKLE_MS 40 // sparkle step
+
+#ifndef BAKED_ANIMATION
+#define BAKED_ANIMATION 0 // 1: bakedAnimation (include/baked_stream.h) joins gPatterns
+#endif
+
+/**
+ * @brief an entry of gPatterns (in PROGMEM)
+ * everything a pattern keeps between updates lives in its own state struct,
+ * all of them share patternState: only the running pattern's member is valid.
+ * on a pattern switch nextPattern() zeroes the state and calls init.
+ * render paints the whole strip from the state, never builds on what is in
+ * 'leds': the hits and transitions blend into it in place.
+ */
+struct Pattern
+{
+  void (*render)();   // called every update_ms, updates 'leds'
+  void (*init)();     // nullptr when all zero is the right start
+  uint8_t state_size; // sizeof its state, for the ram report
+  uint8_t update_ms;
+};
+
+// FillLEDsFromPaletteColors
+struct PaletteState
+{
+  uint8_t startIndex;
+};
+
+// paletteMorph
+struct PaletteMorphState
+{
+  uint8_t startIndex;
+  uint8_t from;   // index in morphPalettes
+  uint8_t amount; // blend into the next one, 0 while holding
+  uint8_t hold;   // updates left before the next blend starts
+};
+
+// bakedAnimation
+struct BakedState
+{
+  uint16_t offset; // next run in bakedRuns
+};
+
+// sparkles, hsv of the sparkling pixels so nothing converts back from rgb
+struct SparkleState
+{
+  uint8_t hue[NUM_LEDS];
+  uint8_t sat[NUM_LEDS];
+  uint8_t val[NUM_LEDS];
+  uint8_t life[NUM_LEDS]; // steps left, 0 = showing the background
+};
+
+// heart_beat, the timers are millis() deadlines, 16 bit is plenty for LUB_TIME
+struct HeartBeatState
+{
+  uint16_t fadeAt;
+  uint16_t lubAt;     // next main lub
+  uint16_t dubAt;     // dub delay after a lub
+  uint16_t lubRampAt;
+  uint16_t dubRampAt;
+  uint16_t hueAt;     // rainbow heart beats
+  bool lubRunning;
+  bool dubRunning;
+  bool dubTrigger;
+  uint8_t lubValue;   // ramp up
+  uint8_t dubValue;
+  uint8_t lubLevel;   // shown, fades out after the ramp
+  uint8_t dubLevel;
+  uint8_t lubHue;
+  uint8_t dubHue;
+  uint8_t hue;
+};
+
+union PatternState
+{
+  PaletteState palette;
+  PaletteMorphState paletteMorph;
+  BakedState baked;
+  SparkleState sparkle;
+  HeartBeatState heartBeat;
+};
+static_assert(sizeof(PatternState) <= 0xFF, "Pattern::state_size is 8 bit");
+
+extern PatternState patternState;
+extern const Pattern gPatterns[] PROGMEM;
+extern const uint8_t gPatternCount;
+
+void initPatternState(const Pattern &pattern);
+
+// every pattern in src/main.cpp
+void rainbowColors();
+void partyColors();
+void oceanColors();
+void forestColors();
+void paletteMorph();
+void bakedAnimation(); // only with include/baked_stream.h
+void christmasSparkles();
+void christmasSparklesRG();
+void christmasSparklesBP();
+void heart_beat_all();
+void heart_beat_all_reverse();
+void heart_beat_eyes_red();
+void heart_beat_eyes_blue();
+void heart_beat_eyes_mono();
+void heart_beat_logo();
+void heart_beat_init();
+
+// and its gPatterns entry, PATTERN_ENTRY(rainbowColors): gPatterns picks from these, the host programs list them all
+#define PATTERN_ENTRY(name) PATTERN_ENTRY_##name
+#define PATTERN_ENTRY_rainbowColors          {rainbowColors,          nullptr,         sizeof(PaletteState),      FRAME_MS}
+#define PATTERN_ENTRY_partyColors            {partyColors,            nullptr,         sizeof(PaletteState),      FRAME_MS}
+#define PATTERN_ENTRY_oceanColors            {oceanColors,            nullptr,         sizeof(PaletteState),      FRAME_MS}
+#define PATTERN_ENTRY_forestColors           {forestColors,           nullptr,         sizeof(PaletteState),      FRAME_MS}
+#define PATTERN_ENTRY_paletteMorph           {paletteMorph,           nullptr,         sizeof(PaletteMorphState), FRAME_MS}
+#define PATTERN_ENTRY_bakedAnimation         {bakedAnimation,         nullptr,         sizeof(BakedState),        FRAME_MS} // baked at FRAME_MS
+#define PATTERN_ENTRY_christmasSparkles      {christmasSparkles,      nullptr,         sizeof(SparkleState),      SPARKLE_MS}
+#define PATTERN_ENTRY_christmasSparklesRG    {christmasSparklesRG,    nullptr,         sizeof(SparkleState),      SPARKLE_MS}
+#define PATTERN_ENTRY_christmasSparklesBP    {christmasSparklesBP,    nullptr,         sizeof(SparkleState),      SPARKLE_MS}
+#define PATTERN_ENTRY_heart_beat_all         {heart_beat_all,         heart_beat_init, sizeof(HeartBeatState),    5} // fades every 5 ms, brightens every 7 ms
+#define PATTERN_ENTRY_heart_beat_all_reverse {heart_beat_all_reverse, heart_beat_init, sizeof(HeartBeatState),    5}
+#define PATTERN_ENTRY_heart_beat_eyes_red    {heart_beat_eyes_red,    heart_beat_init, sizeof(HeartBeatState),    5}
+#define PATTERN_ENTRY_heart_beat_eyes_blue   {heart_beat_eyes_blue,   heart_beat_init, sizeof(HeartBeatState),    5}
+#define PATTERN_ENTRY_heart_beat_eyes_mono   {heart_beat_eyes_mono,   heart_beat_init, sizeof(HeartBeatState),    5}
+#define PATTERN_ENTRY_heart_beat_logo        {heart_beat_logo,        heart_beat_init, sizeof(HeartBeatState),    5}
+
+#endif
@@ -0,0 +1,100 @@
+#include "power.h"
+#include "data.h"
+#ifndef NATIVE_HAL
+#include <avr/sleep.h>
+#endif
+
+#define TIMER0_OVERFLOW_US 2048 // millis() tick at 8 MHz / 64 / 256, the latest an idle core wakes
+
+#if IR_TIMER1
+// the compare match only has to end the sleep
+ISR(TIMER1_COMPA_vect)
+{
+    TIMSK &= ~_BV(OCIE1A);
+}
+#endif
+
+IdleSleep::IdleSleep()
+{
+    resetStats();
+}
+
+void IdleSleep::sleep(uint32_t us)
+{
+    uint32_t start = micros();
+    uint8_t edges = Data.getPinChangeCount();
+    bool slept_once = false;
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    for (;;)
+    {
+        uint32_t elapsed = micros() - start;
+        if (elapsed >= us)
+            break;
+        uint32_t left = us - elapsed;
+#if IR_TIMER1
+        if (left < 2 * IR_TICK_US)
+            break; // the compare can't be set up closer than that
+        if (left < 256 * IR_TICK_US)
+        {
+            // Timer1 counts on for the ir timestamps, wake when it gets there
+            TIFR = _BV(OCF1A);
+            OCR1A = TCNT1 + (uint8_t)(left / IR_TICK_US);
+            TIMSK |= _BV(OCIE1A);
+        }
+#else
+        if (left < TIMER0_OVERFLOW_US)
+            break; // the next wake could be too late, loop() polls the rest
+#endif
+
+        cli();
+        if (Data.getPinChangeCount() != edges)
+        {
+            sei();
+            break; // an edge came in while setting up
+        }
+        sleep_enable();
+        sei();
+        sleep_cpu(); // the instruction after sei runs before any interrupt: no wake is lost
+        sleep_disable();
+        slept_once = true;
+
+        if (Data.getPinChangeCount() != edges)
+        {
+            count_saturating(wakes[eWakeIr]);
+            break;
+        }
+        count_saturating(wakes[eWakeTimer]);
+    }
+#if IR_TIMER1
+    TIMSK &= ~_BV(OCIE1A);
+#endif
+
+    if (slept_once)
+    {
+        count_saturating(sleeps);
+        slept += micros() - start;
+    }
+}
+
+uint16_t IdleSleep::getWakeCount(WakeSource source) { return wakes[source]; }
+uint16_t IdleSleep::getSleepCount() { return sleeps; }
+uint32_t IdleSleep::getSleptMicros() { return slept; }
+
+uint16_t IdleSleep::getAwakePermille()
+{
+    uint32_t total = (micros() - since) / 1000;
+    if (total == 0)
+        return 1000;
+    uint32_t asleep = slept / total;
+    return asleep >= 1000 ? 0 : 1000 - asleep;
+}
+
+void IdleSleep::resetStats()
+{
+    since = micros();
+    slept = 0;
+    for (uint16_t &wake : wakes)
+        wake = 0;
+    sleeps = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef POWER_H
+#define POWER_H
+#include <Arduino.h>
+
+/**
+ * @brief idle sleep between the frames
+ * loop() has nothing to do between its deadlines but to wait for them.
+ * sleep() puts the core in idle mode: only the cpu clock stops, Timer0 (millis),
+ * Timer1 (ir timestamps) and the pin change interrupt keep running and any of
+ * them wakes it. it goes back to sleep until the time is up, but returns on the
+ * first ir edge, so loop() sees a frame just as soon as when it polls.
+ * with IR_TIMER1 the end of the sleep is a Timer1 compare match (16 us),
+ * otherwise the last Timer0 overflow period before it is polled.
+ */
+#ifndef IDLE_SLEEP
+#define IDLE_SLEEP 1 // 0: loop() polls, for comparison on the bench
+#endif
+
+enum WakeSource : uint8_t
+{
+  eWakeIr,    // edge on a receiver pin
+  eWakeTimer, // Timer0/Timer1 overflow or the compare match at the end
+  eWakeSources
+};
+
+class IdleSleep
+{
+private:
+  uint32_t since;               // micros() at resetStats
+  uint32_t slept;               // time spent in sleep() since resetStats [microseconds]
+  uint16_t wakes[eWakeSources]; // saturate
+  uint16_t sleeps;              // sleep() calls that did sleep, saturates
+
+public:
+  IdleSleep();
+  void sleep(uint32_t us); // idle for up to us, back early on an ir edge
+
+  uint16_t getWakeCount(WakeSource source);
+  uint16_t getSleepCount();
+  uint32_t getSleptMicros();
+  uint16_t getAwakePermille(); // share of the time since resetStats spent outside sleep()
+  void resetStats();
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "scheduler.h"
+
+Ticker::Ticker(uint32_t period_us)
+{
+    period = period_us;
+    deadline = 0;
+    resetStats();
+}
+
+void Ticker::setPeriod(uint32_t period_us)
+{
+    period = period_us;
+    restart();
+}
+
+void Ticker::restart()
+{
+    deadline = micros() + period;
+}
+
+bool Ticker::due()
+{
+    return (int32_t)(micros() - deadline) >= 0;
+}
+
+void Ticker::next()
+{
+    uint32_t late = micros() - deadline;
+    if (late >= period)
+    {
+        // we fell behind, drop the lost ticks (rare, so the division is fine)
+        uint32_t lost = late / period;
+        deadline += lost * period;
+        late -= lost * period;
+        missed = (missed + lost > 0xFFFF) ? 0xFFFF : missed + lost;
+    }
+    deadline += period;
+
+    if (late > maxLate)
+        maxLate = late > 0xFFFF ? 0xFFFF : late;
+    ticks++;
+}
+
+uint32_t Ticker::untilDue()
+{
+    int32_t left = deadline - micros();
+    return left > 0 ? left : 0;
+}
+
+uint16_t Ticker::getTicks() { return ticks; }
+uint16_t Ticker::getMissed() { return missed; }
+uint16_t Ticker::getMaxLate() { return maxLate; }
+
+void Ticker::resetStats()
+{
+    ticks = 0;
+    missed = 0;
+    maxLate = 0;
+}
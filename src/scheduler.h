@@ -0,0 +1,35 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <Arduino.h>
+
+/**
+ * @brief fixed rate tick on absolute micros() deadlines
+ * the next deadline is always the previous one plus the period, so the rate
+ * doesn't drift with how long the work of a tick took.
+ * a tick that starts a full period or more late skips the lost ticks instead
+ * of bursting to catch up, and counts them as missed.
+ */
+class Ticker
+{
+private:
+  uint32_t period;   // [microseconds]
+  uint32_t deadline; // micros() of the next tick
+  uint16_t ticks;    // since resetStats
+  uint16_t missed;   // ticks skipped because we were a whole period late
+  uint16_t maxLate;  // worst lateness of a tick [microseconds], saturates
+
+public:
+  Ticker(uint32_t period_us);
+  void setPeriod(uint32_t period_us);
+  void restart();         // next tick one period from now
+  bool due();             // deadline reached, call next() and do the work
+  void next();            // account this tick and move the deadline
+  uint32_t untilDue();    // microseconds left, 0 when due
+
+  uint16_t getTicks();
+  uint16_t getMissed();
+  uint16_t getMaxLate();  // frame time jitter
+  void resetStats();
+};
+
+#endif
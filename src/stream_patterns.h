@@ -0,0 +1,42 @@
+#ifndef STREAM_PATTERNS_H
+#define STREAM_PATTERNS_H
+#include "stream_show.h"
+
+/**
+ * @brief generators for streamShow(), time is in frames
+ * they keep no state between pixels, every color_at is a function of its arguments
+ */
+
+// FillLEDsFromPaletteColors without 'leds': the palette scrolls one index per frame
+struct PaletteStream
+{
+  const TProgmemRGBPalette16 &palette;
+
+  PaletteStream(const TProgmemRGBPalette16 &palette) : palette(palette) {}
+  CRGB color_at(uint16_t index, uint16_t time) const
+  {
+    return ColorFromPalette(palette, time + index * 3, 255, LINEARBLEND);
+  }
+};
+
+// the hat: pulsing red eyes, the logo cycling through the rainbow, the rest dim
+struct HatStream
+{
+  typedef Layout::Eyes Eyes;
+  typedef Layout::Logo Logo;
+
+  CRGB color_at(uint16_t index, uint16_t time) const
+  {
+    if (Eyes::contains(index))
+    {
+      uint8_t phase = time * 4;
+      uint8_t level = phase < 128 ? phase * 2 : (255 - phase) * 2; // triangle, about a second
+      return CRGB(level, 0, 0);
+    }
+    if (Logo::contains(index))
+      return ColorFromPalette(RainbowColors_p, time + Logo::position(index) * 32, 255, LINEARBLEND);
+    return CRGB(8, 8, 16);
+  }
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "stream_show.h"
+
+#ifdef NATIVE_HAL
+#include <vector>
+
+void native_hal_show(const CRGB *leds, uint16_t num_leds, uint8_t brightness); // native_hal.cpp
+
+// the host has the ram: collect the pixels and hand them over like FastLED.show()
+static std::vector<CRGB> streamed;
+static uint8_t stream_brightness;
+
+void streamBegin(uint8_t brightness, LEDColorCorrection)
+{
+    streamed.clear();
+    stream_brightness = brightness;
+}
+
+bool streamPixel(const CRGB &color, bool)
+{
+    streamed.push_back(color);
+    return true;
+}
+
+void streamEnd()
+{
+    native_hal_show(streamed.data(), streamed.size(), stream_brightness);
+}
+
+#else
+static uint8_t scale_r, scale_g, scale_b; // brightness times correction
+static uint8_t stream_sreg;
+static uint32_t stream_end_us; // the leds latch after 50 us low
+#if STREAM_IRQ_GAPS
+static uint8_t stream_pixel_end; // TCNT0 after the last pixel went out
+static bool stream_latched;      // the next pixel is the first the leds take
+#endif
+
+// one byte msb first, 8 MHz timing as in light_ws2812 (cpldcpu):
+// a 0 is 2 cycles high, a 1 is 7 cycles high, a bit is 11 cycles
+static inline void ws2812_byte(uint8_t byte, uint8_t hi, uint8_t lo)
+{
+    uint8_t ctr;
+    asm volatile(
+        "       ldi   %0,8   \n\t"
+        "loop%=:             \n\t"
+        "       out   %2,%3  \n\t" // '1' [01] '0' [01] - rising edge
+        "       sbrs  %1,7   \n\t" // '1' [03] '0' [02]
+        "       out   %2,%4  \n\t" // '1' [--] '0' [03] - falling edge of a 0
+        "       lsl   %1     \n\t" // '1' [04] '0' [04]
+        "       rjmp  .+0    \n\t" // '1' [06] '0' [06]
+        "       nop          \n\t" // '1' [07] '0' [07]
+        "       out   %2,%4  \n\t" // '1' [08] '0' [08] - falling edge of a 1
+        "       dec   %0     \n\t" // '1' [09] '0' [09]
+        "       brne  loop%= \n\t" // '1' [11] '0' [11]
+        : "=&d"(ctr), "+r"(byte)
+        : "I"(_SFR_IO_ADDR(PORTB)), "r"(hi), "r"(lo));
+}
+
+void streamBegin(uint8_t brightness, LEDColorCorrection correction)
+{
+    DDRB |= (1 << STREAM_PIN);
+    scale_r = scale8(correction >> 16, brightness);
+    scale_g = scale8((correction >> 8) & 0xFF, brightness);
+    scale_b = scale8(correction & 0xFF, brightness);
+
+    while (micros() - stream_end_us < 50)
+        ; // latch of the previous frame
+    stream_sreg = SREG;
+#if STREAM_IRQ_GAPS
+    stream_latched = true;
+#else
+    cli();
+#endif
+}
+
+bool streamPixel(const CRGB &color, bool restart)
+{
+    uint8_t g = scale8(color.g, scale_g);
+    uint8_t r = scale8(color.r, scale_r);
+    uint8_t b = scale8(color.b, scale_b);
+    uint8_t hi = PORTB | (1 << STREAM_PIN);
+    uint8_t lo = PORTB & ~(1 << STREAM_PIN);
+#if STREAM_IRQ_GAPS
+    uint8_t sreg = SREG;
+    cli();
+    if (restart && !stream_latched && (uint8_t)(TCNT0 - stream_pixel_end) >= STREAM_GAP_TICKS)
+    {
+        stream_latched = true; // this pixel would land on the first led
+        SREG = sreg;
+        return false;
+    }
+#else
+    (void)restart; // no gaps, the line never idles that long
+#endif
+    ws2812_byte(g, hi, lo);
+    ws2812_byte(r, hi, lo);
+    ws2812_byte(b, hi, lo);
+#if STREAM_IRQ_GAPS
+    stream_pixel_end = TCNT0;
+    stream_latched = false;
+    SREG = sreg;
+#endif
+    return true;
+}
+
+void streamEnd()
+{
+    SREG = stream_sreg;
+    stream_end_us = micros();
+}
+#endif
@@ -0,0 +1,59 @@
+#ifndef STREAM_SHOW_H
+#define STREAM_SHOW_H
+#include <Arduino.h>
+#include <FastLED.h>
+#include "layout.h"
+
+/**
+ * @brief WS2812 output without a framebuffer
+ * a generator hands out the strip one pixel at a time through
+ * CRGB color_at(uint16_t index, uint16_t time), every pixel goes out on the
+ * wire before the next one is computed, so the strip length isn't bound by
+ * the 3 bytes per led of 'leds' any more, only by the wire time (33 us per led
+ * at 8 MHz) plus color_at.
+ * the leds hold the line low between two pixels while color_at runs, that has
+ * to stay well under their reset time (50 us for the old WS2812, more for the
+ * WS2812B): a palette sample or a few scale8 are fine, hsv2rgb is about the limit.
+ * with interrupts off for more than a Timer0 overflow (2048 us) millis() falls behind
+ * and a second ir edge in that time is lost: without STREAM_IRQ_GAPS the strip is
+ * capped at STREAM_MAX_LEDS, longer ones need STREAM_IRQ_GAPS.
+ */
+#define STREAM_PIN 3      // PB3, LED_PIN in main.cpp
+#define STREAM_PIXEL_US 33 // 24 bits of 11 cycles at 8 MHz
+
+// interrupts are off for the whole strip like FastLED.show(), with this set they
+// only are while a pixel goes out, the ir ISR then runs in the gaps.
+// an ISR can stretch a gap past the reset time (PCINT0_vect on a frame's last edge),
+// the leds then latch what they have and take the next pixel as their first:
+// streamPixel() sees that on Timer0 and the frame starts over from its first led,
+// up to STREAM_RESTARTS times, after that the frame stays torn until the next one
+#ifndef STREAM_IRQ_GAPS
+#define STREAM_IRQ_GAPS 0
+#endif
+#define STREAM_MAX_LEDS 60 // with interrupts off for the whole strip: 60 * 33 us + 50 us latch, under 2048 us
+#define STREAM_GAP_TICKS 6 // Timer0 ticks of 8 us between two pixels the leds may have latched in: 40 us and more
+#define STREAM_RESTARTS 2
+
+void streamBegin(uint8_t brightness, LEDColorCorrection correction);
+// GRB on the wire, scaled by brightness and correction. false when the leds latched in the gap
+// before it and 'restart' is set, the pixel didn't go out then
+bool streamPixel(const CRGB &color, bool restart);
+void streamEnd();
+
+template <typename Generator>
+void streamShow(const Generator &generator, uint16_t num_leds, uint16_t time, uint8_t brightness)
+{
+  uint8_t restarts = STREAM_RESTARTS;
+  streamBegin(brightness, TypicalLEDStrip);
+  for (uint16_t i = 0; i < num_leds; i++)
+  {
+    if (!streamPixel(generator.color_at(i, time), restarts != 0))
+    {
+      restarts--;
+      i = -1; // from the first led again
+    }
+  }
+  streamEnd();
+}
+
+#endif
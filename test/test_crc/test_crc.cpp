@@ -0,0 +1,71 @@
+/**
+ * @brief _data::calculateCRC against the shift-xor version it replaced ([env:native])
+ * pio test -e native -f test_crc
+ * every 4099th of the 2^32 inputs, about a million; built with -DTEST_CRC_EXHAUSTIVE
+ * (PLATFORMIO_BUILD_FLAGS) it takes all of them, a few minutes.
+ */
+#include <stdio.h>
+#include <unity.h>
+
+#include "data.h"
+
+#ifdef TEST_CRC_EXHAUSTIVE
+#define TEST_CRC_STEP 1
+#else
+#define TEST_CRC_STEP 4099
+#endif
+
+// _data::calculateCRC as it was before the table version, the reference to match bit for bit
+static uint32_t reference_crc(uint32_t raw_packet)
+{
+    uint32_t raw = raw_packet;
+    uint32_t checksum = ((raw << 2) & 0b10000000111111110111111100) ^
+                        ((raw << 1) & 0b01111111100000000111111110) ^
+                        ((raw << 0) & 0b00000000111111111111111111) ^
+                        ((raw >> 1) & 0b00000000100000000000000000) ^
+                        ((raw >> 2) & 0b00000000011111110000000000) ^
+                        ((raw >> 3) & 0b00000000111111111000000000) ^
+                        ((raw >> 4) & 0b00000011100000001111111100) ^
+                        ((raw >> 5) & 0b00000000111111111000000010);
+    checksum = checksum ^ (checksum >> 8) ^ (checksum >> 16) ^ (checksum >> 24);
+    checksum = checksum & 0xFF;
+    raw ^= checksum << 24;
+    return raw;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_table_matches_the_reference()
+{
+    for (uint64_t raw = 0; raw <= 0xFFFFFFFF; raw += TEST_CRC_STEP)
+    {
+        if (Data.calculateCRC(raw) != reference_crc(raw))
+        {
+            char message[32];
+            snprintf(message, sizeof(message), "mismatch at %08lx", (unsigned long)raw);
+            TEST_FAIL_MESSAGE(message);
+        }
+    }
+}
+
+// every sealed packet has to be accepted again
+static void test_sealed_packets_check_out()
+{
+    uint32_t rejected = 0;
+    for (uint32_t payload = 0; payload < (1UL << 22); payload += 7)
+    {
+        uint32_t sealed = Data.encodePacket(IrDataPacket(payload)).get_raw();
+        if (IrDataPacket(Data.calculateCRC(sealed)).get_crc() != 0)
+            rejected++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, rejected);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_table_matches_the_reference);
+    RUN_TEST(test_sealed_packets_check_out);
+    return UNITY_END();
+}
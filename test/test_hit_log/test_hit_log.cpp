@@ -0,0 +1,161 @@
+/**
+ * @brief the hit log ring in eeprom over reboots and power cuts mid record ([env:native])
+ * pio test -e native -f test_hit_log
+ * lib/nativeHal programs the eeprom in virtual time, a byte every few ms like EE_RDY_vect
+ * on the avr, and keeps it over nativeHal::reset() like a power cycle does.
+ */
+#include <string.h>
+#include <unity.h>
+
+#include "native_hal.h"
+#include "hit_log.h"
+
+static_assert(HIT_LOG, "[env:native] builds with -DHIT_LOG=1");
+
+static IrDataPacket hit(uint16_t n)
+{
+    IrDataPacket p(0);
+    p.set_team(1 << (n % 3));
+    p.set_action(eActionDamage);
+    p.set_action_param(n % 16);
+    p.set_player_id(n & 0xFFF);
+    return p;
+}
+
+// what a record keeps of a packet
+static uint32_t logged(IrDataPacket p)
+{
+    return p.get_raw() & ((1UL << IrDataPacket::PlayerId::next) - (1UL << IrDataPacket::Team::offset));
+}
+
+// log hits 'from' up to 'to' a few at a time, the eeprom done in between like loop() would let it
+static void log_hits(uint16_t from, uint16_t to)
+{
+    for (uint16_t n = from; n < to; n++)
+    {
+        hitLog.log(hit(n));
+        if (hitLog.pending() == HIT_LOG_QUEUE)
+            nativeHal::advanceMillis(20);
+    }
+    while (hitLog.pending())
+        nativeHal::advanceMillis(20);
+    nativeHal::advanceMillis(20);
+}
+
+// power cycle: whatever write runs is lost, begin() scans the ring again
+static void reboot()
+{
+    nativeHal::reset();
+    hitLog.begin();
+}
+
+// the ring holds the last 'expected' of hits 0..last-1, 'lost' left out
+static void check_ring(uint16_t last, uint16_t expected, uint16_t lost = 0xFFFF)
+{
+    TEST_ASSERT_EQUAL_UINT8(expected, hitLog.count());
+    uint16_t n = last;
+    for (int16_t i = hitLog.count() - 1; i >= 0; i--)
+    {
+        if (--n == lost)
+            n--;
+        TEST_ASSERT_EQUAL_HEX32(logged(hit(n)), hitLog.read(i).get_raw());
+    }
+}
+
+// a blank eeprom before every test
+void setUp()
+{
+    memset(nativeHal::eeprom(), 0xFF, E2END + 1);
+    reboot();
+}
+
+void tearDown() {}
+
+static void test_fresh_ring_is_empty()
+{
+    check_ring(0, 0);
+}
+
+static void test_records_survive_a_reboot()
+{
+    log_hits(0, 50);
+    reboot();
+    check_ring(50, 50);
+}
+
+static void test_ring_wraps_around()
+{
+    log_hits(0, 300);
+    reboot();
+    check_ring(300, HIT_LOG_SLOTS);
+}
+
+// a power cut in the middle of a record: the hit is lost, and the oldest record it was overwriting
+static void test_torn_data_loses_that_hit()
+{
+    log_hits(0, 300);
+    uint32_t writes = nativeHal::eepromWrites();
+    hitLog.log(hit(300));
+    while (nativeHal::eepromWrites() - writes < 2)
+        nativeHal::advanceMicros(100);
+    reboot();
+    check_ring(300, HIT_LOG_SLOTS - 1);
+
+    log_hits(301, 310);
+    reboot();
+    check_ring(310, HIT_LOG_SLOTS, 300);
+}
+
+// cut right after the erase of the sequence byte
+static void test_torn_sequence_loses_that_hit()
+{
+    log_hits(0, 300);
+    uint32_t writes = nativeHal::eepromWrites();
+    hitLog.log(hit(300));
+    while (nativeHal::eepromWrites() == writes)
+        nativeHal::advanceMicros(100);
+    reboot();
+    check_ring(300, HIT_LOG_SLOTS - 1);
+}
+
+// full queue: the rest is dropped and counted, not waited for
+static void test_full_queue_counts_the_drops()
+{
+    uint8_t drops = hitLog.getDropCount();
+    for (uint16_t n = 0; n < HIT_LOG_QUEUE + 3; n++)
+        hitLog.log(hit(n));
+    TEST_ASSERT_EQUAL_UINT8(HIT_LOG_QUEUE, hitLog.pending());
+    TEST_ASSERT_EQUAL_UINT8(3, hitLog.getDropCount() - drops);
+    log_hits(0, 0);
+    check_ring(HIT_LOG_QUEUE, HIT_LOG_QUEUE);
+}
+
+// every slot takes its turn
+static void test_wear_spreads_evenly()
+{
+    static uint32_t wear_before[E2END + 1];
+    for (uint16_t a = 0; a <= E2END; a++)
+        wear_before[a] = nativeHal::eepromWear(a);
+    log_hits(0, 20 * HIT_LOG_SLOTS);
+    uint32_t least = 0xFFFFFFFF, most = 0;
+    for (uint16_t slot = 0; slot < HIT_LOG_SLOTS; slot++)
+    {
+        uint32_t wear = nativeHal::eepromWear(slot * HIT_LOG_RECORD) - wear_before[slot * HIT_LOG_RECORD];
+        least = wear < least ? wear : least;
+        most = wear > most ? wear : most;
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, least, most);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fresh_ring_is_empty);
+    RUN_TEST(test_records_survive_a_reboot);
+    RUN_TEST(test_ring_wraps_around);
+    RUN_TEST(test_torn_data_loses_that_hit);
+    RUN_TEST(test_torn_sequence_loses_that_hit);
+    RUN_TEST(test_full_queue_counts_the_drops);
+    RUN_TEST(test_wear_spreads_evenly);
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/**
+ * @brief the i2c registers of the hat, the controller played on lib/nativeHal bit by bit ([env:native])
+ * pio test -e native -f test_i2c_target
+ * the firmware runs along (test_build_src): loop() takes the pattern and the brightness
+ * and fills the status like on the hat.
+ */
+#include <unity.h>
+#include <vector>
+
+#include <FastLED.h>
+#include "native_hal.h"
+#include "i2c_target.h"
+#include "patterns.h"
+
+static_assert(I2C_TARGET, "[env:native] builds with -DI2C_TARGET=1");
+
+void startPattern(uint8_t number);
+extern uint8_t gCurrentPatternNumber;
+
+// a write of the register, then a repeated start and 'count' bytes from it
+static bool host_read(uint8_t reg, uint8_t *data, uint8_t count)
+{
+    bool acked = nativeHal::i2cStart(I2C_ADDRESS, false) && nativeHal::i2cWrite(reg) && nativeHal::i2cStart(I2C_ADDRESS, true);
+    for (uint8_t i = 0; i < count; i++)
+        data[i] = nativeHal::i2cRead(i + 1 < count);
+    nativeHal::i2cStop();
+    return acked;
+}
+
+static bool host_write(uint8_t reg, uint8_t value)
+{
+    bool acked = nativeHal::i2cStart(I2C_ADDRESS, false) && nativeHal::i2cWrite(reg) && nativeHal::i2cWrite(value);
+    nativeHal::i2cStop();
+    return acked;
+}
+
+// all packets waiting, in one read: the count, then as many packets
+static uint8_t host_packets(std::vector<uint32_t> &packets)
+{
+    nativeHal::i2cStart(I2C_ADDRESS, false);
+    nativeHal::i2cWrite(eI2cPackets);
+    nativeHal::i2cStart(I2C_ADDRESS, true);
+    uint8_t count = nativeHal::i2cRead(true);
+    if (count == 0)
+        nativeHal::i2cRead(false); // acked the count, one more byte ends it
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t raw = 0;
+        for (uint8_t b = 0; b < 4; b++)
+            raw |= (uint32_t)nativeHal::i2cRead(i + 1 < count || b < 3) << (8 * b);
+        packets.push_back(raw);
+    }
+    nativeHal::i2cStop();
+    return count;
+}
+
+static bool host_status(I2cStatus &status)
+{
+    return host_read(eI2cStatus, (uint8_t *)&status, sizeof(status));
+}
+
+static IrDataPacket packet(uint8_t n)
+{
+    return IrDataPacket(0x1230 + (n << 10));
+}
+
+void setUp()
+{
+    nativeHal::reset();
+    i2cTarget.begin();
+}
+
+void tearDown() {}
+
+static void test_other_address_not_acked()
+{
+    bool acked = nativeHal::i2cStart(I2C_ADDRESS + 1, false);
+    nativeHal::i2cStop();
+    TEST_ASSERT_FALSE(acked);
+    TEST_ASSERT_EQUAL_UINT32(3, nativeHal::i2cInterrupts()); // start, SCL falls, address
+}
+
+// SCL never falls after the start: nothing waits for it, the next transfer works
+static void test_stuck_start_left_behind()
+{
+    nativeHal::i2cStuckStart();
+    nativeHal::i2cStop();
+    bool acked = nativeHal::i2cStart(I2C_ADDRESS, false);
+    nativeHal::i2cStop();
+    TEST_ASSERT_TRUE(acked);
+}
+
+static void test_status()
+{
+    loop();
+    I2cStatus status = {};
+    TEST_ASSERT_TRUE(host_status(status));
+    TEST_ASSERT_EQUAL_UINT8(I2C_PROTOCOL_VERSION, status.version);
+    TEST_ASSERT_EQUAL_UINT8(gCurrentPatternNumber, status.pattern);
+    TEST_ASSERT_EQUAL_UINT8(FastLED.getBrightness(), status.brightness);
+}
+
+static void test_pattern_and_brightness()
+{
+    uint8_t brightness = FastLED.getBrightness();
+    TEST_ASSERT_TRUE(host_write(eI2cPattern, 2));
+    TEST_ASSERT_TRUE(host_write(eI2cBrightness, 77));
+    loop();
+    I2cStatus status = {};
+    host_status(status);
+    TEST_ASSERT_EQUAL_UINT8(2, gCurrentPatternNumber);
+    TEST_ASSERT_EQUAL_UINT8(77, FastLED.getBrightness());
+    TEST_ASSERT_EQUAL_UINT8(2, status.pattern);
+    TEST_ASSERT_EQUAL_UINT8(77, status.brightness);
+
+    host_write(eI2cPattern, gPatternCount); // past the end, ignored
+    loop();
+    TEST_ASSERT_EQUAL_UINT8(2, gCurrentPatternNumber);
+    FastLED.setBrightness(brightness);
+    startPattern(0);
+}
+
+// a batch of packets, then nothing left
+static void test_batch_read()
+{
+    std::vector<uint32_t> sent, read;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        sent.push_back(packet(i).get_raw());
+        i2cTarget.push(packet(i));
+    }
+    TEST_ASSERT_EQUAL_UINT8(3, host_packets(read));
+    TEST_ASSERT_EQUAL_UINT8(0, host_packets(read));
+    TEST_ASSERT_TRUE(read == sent);
+}
+
+// a read that stops in the middle of a packet gets it whole the next time
+static void test_packet_read_halfway_stays_queued()
+{
+    i2cTarget.push(packet(3));
+    uint8_t partial[3];
+    host_read(eI2cPackets, partial, 3);
+    TEST_ASSERT_EQUAL_UINT8(1, partial[0]);
+    std::vector<uint32_t> read;
+    TEST_ASSERT_EQUAL_UINT8(1, host_packets(read));
+    TEST_ASSERT_EQUAL_HEX32(packet(3).get_raw(), read[0]);
+}
+
+// the host doesn't read: the queue fills up, the rest is counted
+static void test_full_queue_counts_the_drops()
+{
+    I2cStatus status = {};
+    host_status(status);
+    uint8_t dropped = status.dropped;
+    for (uint8_t i = 0; i < I2C_QUEUE + 2; i++)
+        i2cTarget.push(packet(4 + i));
+    host_status(status);
+    std::vector<uint32_t> read;
+    TEST_ASSERT_EQUAL_UINT8(I2C_QUEUE, host_packets(read));
+    TEST_ASSERT_EQUAL_UINT8(2, (uint8_t)(status.dropped - dropped));
+    TEST_ASSERT_EQUAL_HEX32(packet(4).get_raw(), read[0]);
+}
+
+int main(int argc, char **argv)
+{
+    nativeHal::reset();
+    setup();
+    UNITY_BEGIN();
+    RUN_TEST(test_other_address_not_acked);
+    RUN_TEST(test_stuck_start_left_behind);
+    RUN_TEST(test_status);
+    RUN_TEST(test_pattern_and_brightness);
+    RUN_TEST(test_batch_read);
+    RUN_TEST(test_packet_read_halfway_stays_queued);
+    RUN_TEST(test_full_queue_counts_the_drops);
+    return UNITY_END();
+}
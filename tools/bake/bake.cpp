@@ -0,0 +1,124 @@
+/**
+ * @brief bakes a pattern into a PROGMEM stream for bakedAnimation ([env:bake])
+ * pio run -e bake && .pio/build/bake/program [pattern] [start_ms] [length_ms] > include/baked_stream.h
+ * or python tools/bake/bake.py, which does both. the header is checked in, bake it again
+ * by hand after changing the pattern it was baked from or the Layout.
+ *
+ * the pattern runs on the virtual clock of lib/nativeHal like in the native bench,
+ * one frame is recorded every BAKED_FRAME_MS from start_ms on.
+ * the stream is palette indexed run length: every distinct color once in bakedColors,
+ * a frame is runs of (count, color index) that add up to NUM_LEDS.
+ * no deltas against the previous frame: the hits and transitions blend into 'leds',
+ * every frame has to paint the whole strip.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "native_hal.h"
+#include "patterns.h"
+#include "../../bench/native/named_patterns.h"
+
+#define BAKED_FRAME_MS FRAME_MS // the player runs at that rate
+
+// the Layout it was baked for, written into the header
+#define BAKE_STR_(x) #x
+#define BAKE_STR(x) BAKE_STR_(x)
+#ifdef LAYOUT_STRIP
+#define BAKE_LAYOUT "-DLAYOUT_STRIP=" BAKE_STR(LAYOUT_STRIP)
+#else
+#define BAKE_LAYOUT "hat"
+#endif
+
+// a lub to the next of heart_beat_eyes_blue, it repeats every LUB_TIME. live it renders every 5 ms
+// to fade smoothly, the core wakes 200 times a second for it; baked it is one flash read per run every frame
+#define BAKE_PATTERN "heart_beat_eyes_blue"
+#define BAKE_START_MS 1100
+#define BAKE_LENGTH_MS 1104 // LUB_TIME rounded up to whole frames
+
+extern CRGBArray<NUM_LEDS> leds;
+
+static uint8_t color_index(std::vector<CRGB> &colors, const CRGB &color)
+{
+    for (size_t i = 0; i < colors.size(); i++)
+        if (colors[i] == color)
+            return i;
+    if (colors.size() == 256)
+    {
+        fprintf(stderr, "bake: more than 256 colors, bake a shorter piece\n");
+        exit(1);
+    }
+    colors.push_back(color);
+    return colors.size() - 1;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = argc > 1 ? argv[1] : BAKE_PATTERN;
+    uint32_t start_ms = argc > 2 ? strtoul(argv[2], NULL, 10) : BAKE_START_MS;
+    uint32_t length_ms = argc > 3 ? strtoul(argv[3], NULL, 10) : BAKE_LENGTH_MS;
+
+    const Pattern *pattern = nullptr;
+    for (const NamedPattern &named : patterns)
+        if (!strcmp(named.name, name))
+            pattern = &named.pattern;
+    if (!pattern)
+    {
+        fprintf(stderr, "bake: no pattern %s\n", name);
+        return 1;
+    }
+
+    nativeHal::reset();
+    initPatternState(*pattern);
+
+    // render on the pattern's own deadlines like patternTicker, record every frame
+    std::vector<CRGB> colors;
+    std::vector<uint8_t> runs;
+    uint32_t frames = 0;
+    uint32_t due = 0;
+    for (uint32_t t = 0; t < start_ms + length_ms; t += BAKED_FRAME_MS)
+    {
+        for (; (int32_t)(millis() - due) >= 0; due += pattern->update_ms)
+            pattern->render();
+        if (t >= start_ms)
+        {
+            for (uint16_t i = 0; i < NUM_LEDS;)
+            {
+                uint8_t count = 1;
+                while (count < 255 && i + count < NUM_LEDS && leds[i + count] == leds[i])
+                    count++;
+                runs.push_back(count);
+                runs.push_back(color_index(colors, leds[i]));
+                i += count;
+            }
+            frames++;
+        }
+        nativeHal::advanceMillis(BAKED_FRAME_MS);
+    }
+
+    printf("// generated by tools/bake from %s, %lu ms from %lu ms on, do not edit\n", name, (unsigned long)length_ms,
+           (unsigned long)start_ms);
+    printf("// only included by src/main.cpp\n");
+    printf("// layout: %s\n", BAKE_LAYOUT);
+    printf("#ifndef BAKED_STREAM_H\n#define BAKED_STREAM_H\n\n");
+    printf("#define BAKED_LEDS %d\n", NUM_LEDS);
+    printf("#define BAKED_FRAMES %lu\n", (unsigned long)frames);
+    printf("#define BAKED_FRAME_MS %d\n\n", BAKED_FRAME_MS);
+    printf("const uint8_t bakedColors[][3] PROGMEM =\n{");
+    for (size_t i = 0; i < colors.size(); i++)
+        printf("%s{%u, %u, %u},", i % 6 ? " " : "\n    ", colors[i].r, colors[i].g, colors[i].b);
+    printf("\n};\n\n");
+    printf("// (count, color) runs, BAKED_LEDS pixels per frame\n");
+    printf("const uint8_t bakedRuns[] PROGMEM =\n{");
+    for (size_t i = 0; i < runs.size(); i++)
+        printf("%s%u,", i % 16 ? " " : "\n    ", runs[i]);
+    printf("\n};\n\n#endif\n");
+
+    fprintf(stderr, "bake: %s, %lu frames, %lu bytes raw, %lu bytes baked (%lu colors, %lu runs)\n", name,
+            (unsigned long)frames, (unsigned long)frames * NUM_LEDS * 3, (unsigned long)(colors.size() * 3 + runs.size()),
+            (unsigned long)colors.size(), (unsigned long)runs.size() / 2);
+    return 0;
+}
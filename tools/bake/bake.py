@@ -0,0 +1,25 @@
+#!/usr/bin/env python3
+# bakes include/baked_stream.h, run it by hand after changing the baked pattern or the layout:
+#   python tools/bake/bake.py [-DLAYOUT_STRIP=n] [pattern] [start_ms] [length_ms]
+# builds the host recorder of [env:bake] (tools/bake/bake.cpp, needs a host compiler) and keeps
+# its output only when it ran through. the firmware builds need neither, they use the checked in header
+import os
+import subprocess
+import sys
+
+project = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+stream = os.path.join(project, "include", "baked_stream.h")
+
+# the recorder has to paint the same Layout as the firmware
+flags = [arg for arg in sys.argv[1:] if arg.startswith("-D")]
+args = [arg for arg in sys.argv[1:] if not arg.startswith("-D")]
+
+bake_env = dict(os.environ)
+if flags:
+    bake_env["PLATFORMIO_BUILD_FLAGS"] = " ".join(flags)
+subprocess.check_call([sys.executable, "-m", "platformio", "run", "-s", "-e", "bake", "-d", project], env=bake_env)
+program = os.path.join(project, ".pio", "build", "bake", "program")
+with open(stream + ".tmp", "w") as out:
+    subprocess.check_call([program] + args, stdout=out)
+os.replace(stream + ".tmp", stream)
+print("Baked %s" % os.path.relpath(stream, project))